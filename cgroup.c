@@ -0,0 +1,218 @@
+/* =============================================================================
+   cgroup.c
+
+   The implementation of control through cgroup v2. The manager creates a
+   group of its own under a given cgroup v2 directory, and within it a
+   group for every real process, which the process joins before it runs.
+   Writing to `cgroup.freeze` of a group freezes or thaws every process in
+   it, including children that a process has forked, without signalling
+   any of them or waiting for them to stop.
+
+   If the cpu controller can be enabled, every group is also limited to
+   one CPU by `cpu.max`, since the simulated system has one, and given a
+   `cpu.weight` in proportion to the weight of its process, so that real
+   processes share the CPU with other load as they would under CFS.
+
+   Author: David Sha
+============================================================================= */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "config.h"
+#include "cgroup.h"
+
+#define NAME_LENGTH 32
+
+// the group of the manager, under which every process has a group
+static char *group_path = NULL;
+static int group_fd = FAILED;
+static int next_id = 0;
+static int cpu_enabled = FALSE;
+
+static int write_file(int dir_fd, const char *file, const char *value) {
+    /*  Write a value to a file of a group. Return whether it was written.
+     */
+    int fd = openat(dir_fd, file, O_WRONLY | O_CLOEXEC);
+    if (fd == FAILED) {
+        return FALSE;
+    }
+    ssize_t n = write(fd, value, strlen(value));
+    close(fd);
+    return n == (ssize_t)strlen(value);
+}
+
+int open_cgroups(const char *root) {
+    /*  Create the group of the manager under a cgroup v2 directory. Return
+        whether groups can be created and frozen there.
+     */
+    assert(group_fd == FAILED);
+    size_t len = strlen(root) + strlen(CGROUP_PREFIX) + NAME_LENGTH;
+    group_path = (char *)malloc(len);
+    assert(group_path);
+    snprintf(group_path, len, "%s/%s%d", root, CGROUP_PREFIX, (int)getpid());
+    if (mkdir(group_path, 0755) == FAILED) {
+        free(group_path);
+        group_path = NULL;
+        return FALSE;
+    }
+    group_fd = open(group_path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (group_fd == FAILED || faccessat(group_fd, "cgroup.freeze", W_OK, 0)) {
+        // not cgroup v2, or the root group, which cannot be frozen
+        close_cgroups();
+        return FALSE;
+    }
+
+    // the cpu controller must be enabled for the children of the root as
+    // well, which may already be the case or may not be allowed
+    int root_fd = open(root, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (root_fd != FAILED) {
+        write_file(root_fd, "cgroup.subtree_control", "+cpu");
+        close(root_fd);
+    }
+    cpu_enabled = write_file(group_fd, "cgroup.subtree_control", "+cpu");
+    return TRUE;
+}
+
+int has_cgroup_cpu() {
+    /*  Return whether groups are limited by the cpu controller.
+     */
+    return cpu_enabled;
+}
+
+void close_cgroups() {
+    /*  Remove the group of the manager, once every process group has been
+        freed.
+     */
+    if (group_fd != FAILED) {
+        close(group_fd);
+        group_fd = FAILED;
+    }
+    if (group_path) {
+        rmdir(group_path);
+        free(group_path);
+        group_path = NULL;
+    }
+    cpu_enabled = FALSE;
+}
+
+cgroup_t *create_cgroup(uint32_t weight) {
+    /*  Create the group of a process with the given weight. Return NULL if
+        it could not be created.
+     */
+    assert(group_fd != FAILED);
+    char name[NAME_LENGTH];
+    int id = next_id++;
+    snprintf(name, sizeof(name), "process-%d", id);
+    if (mkdirat(group_fd, name, 0755) == FAILED) {
+        return NULL;
+    }
+    cgroup_t *cgroup;
+    cgroup = (cgroup_t *)malloc(sizeof(*cgroup));
+    assert(cgroup);
+    cgroup->id = id;
+    cgroup->frozen = FALSE;
+    cgroup->dir_fd = openat(group_fd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (cgroup->dir_fd == FAILED) {
+        perror(name);
+        exit(EXIT_FAILURE);
+    }
+    cgroup->procs_fd = openat(cgroup->dir_fd, "cgroup.procs",
+                              O_WRONLY | O_CLOEXEC);
+    cgroup->freeze_fd = openat(cgroup->dir_fd, "cgroup.freeze",
+                               O_WRONLY | O_CLOEXEC);
+    if (cgroup->procs_fd == FAILED || cgroup->freeze_fd == FAILED) {
+        perror(name);
+        exit(EXIT_FAILURE);
+    }
+
+    // limits are best effort, as the group works without them
+    if (cpu_enabled) {
+        char value[NAME_LENGTH];
+        uint64_t cpu_weight = (uint64_t)weight * CGROUP_CPU_WEIGHT;
+        if (cpu_weight > CGROUP_MAX_CPU_WEIGHT) {
+            cpu_weight = CGROUP_MAX_CPU_WEIGHT;
+        }
+        snprintf(value, sizeof(value), "%lu", (unsigned long)cpu_weight);
+        write_file(cgroup->dir_fd, "cpu.weight", value);
+        write_file(cgroup->dir_fd, "cpu.max", CGROUP_CPU_MAX);
+    }
+    return cgroup;
+}
+
+static void wait_empty(int dir_fd) {
+    /*  Wait until no process is left in a group, for at most
+        `COMMAND_KILL_TIMEOUT` milliseconds at a time. A change of
+        `cgroup.events` is signalled by POLLPRI.
+     */
+    int fd = openat(dir_fd, "cgroup.events", O_RDONLY | O_CLOEXEC);
+    if (fd == FAILED) {
+        return;
+    }
+    char events[NAME_LENGTH * 4];
+    ssize_t n;
+    while ((n = pread(fd, events, sizeof(events) - 1, 0)) > 0) {
+        events[n] = '\0';
+        struct pollfd pfd = {.fd = fd, .events = POLLPRI};
+        if (strstr(events, "populated 0") ||
+            poll(&pfd, 1, COMMAND_KILL_TIMEOUT) <= 0) {
+            break;
+        }
+    }
+    close(fd);
+}
+
+void free_cgroup(cgroup_t *cgroup) {
+    /*  Close and remove the group of a process, first killing any process
+        left in it, such as a child of a command that outlived the command.
+        The group is left behind if a process in it does not exit.
+     */
+    char name[NAME_LENGTH];
+    snprintf(name, sizeof(name), "process-%d", cgroup->id);
+    kill_cgroup(cgroup);
+    wait_empty(cgroup->dir_fd);
+    close(cgroup->dir_fd);
+    close(cgroup->procs_fd);
+    close(cgroup->freeze_fd);
+    unlinkat(group_fd, name, AT_REMOVEDIR);
+    free(cgroup);
+}
+
+void enter_cgroup(cgroup_t *cgroup) {
+    /*  Move the calling process into a group. Called by a child before it
+        executes, so that every process it forks is in the group too.
+     */
+    char pid[NAME_LENGTH];
+    int len = snprintf(pid, sizeof(pid), "%d", (int)getpid());
+    if (write(cgroup->procs_fd, pid, len) != len) {
+        perror("cgroup.procs");
+        exit(EXIT_FAILURE);
+    }
+}
+
+int freeze_cgroup(cgroup_t *cgroup, int frozen) {
+    /*  Freeze or thaw every process in a group. Freezing takes effect
+        asynchronously and is not waited for. Return whether the group had
+        to be written to.
+     */
+    if (cgroup->frozen == frozen) {
+        return FALSE;
+    }
+    if (pwrite(cgroup->freeze_fd, frozen ? "1" : "0", 1, 0) != 1) {
+        perror("cgroup.freeze");
+        exit(EXIT_FAILURE);
+    }
+    cgroup->frozen = frozen;
+    return TRUE;
+}
+
+int kill_cgroup(cgroup_t *cgroup) {
+    /*  Kill every process in a group. Return FALSE if the kernel does not
+        support killing groups.
+     */
+    return write_file(cgroup->dir_fd, "cgroup.kill", "1");
+}
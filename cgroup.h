@@ -0,0 +1,34 @@
+/* =============================================================================
+   cgroup.h
+
+   Control of real processes through cgroup v2, which freezes the whole
+   tree of a process at once and limits the CPU it may use.
+
+   Author: David Sha
+============================================================================= */
+#ifndef _CGROUP_H_
+#define _CGROUP_H_
+
+/* #includes ================================================================ */
+#include <stdint.h>
+
+/* structures =============================================================== */
+typedef struct cgroup {
+    int id;
+    int dir_fd;
+    int procs_fd;
+    int freeze_fd;
+    int frozen;
+} cgroup_t;
+
+/* function prototypes ====================================================== */
+int open_cgroups(const char *root);
+int has_cgroup_cpu();
+void close_cgroups();
+cgroup_t *create_cgroup(uint32_t weight);
+void free_cgroup(cgroup_t *cgroup);
+void enter_cgroup(cgroup_t *cgroup);
+int freeze_cgroup(cgroup_t *cgroup, int frozen);
+int kill_cgroup(cgroup_t *cgroup);
+
+#endif
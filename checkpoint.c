@@ -0,0 +1,598 @@
+/* =============================================================================
+   checkpoint.c
+
+   The implementation of checkpoints. A snapshot is a compact binary file in
+   host byte order that contains the simulation time, the memory block list
+   and the frame table of paged memory, every process that has arrived (in
+   the order of the input, ready, running, finished, rejected and swapped
+   queues, then those held back by backpressure) and the statistics
+   accumulators.
+
+   Processes that have not yet arrived are not part of the snapshot. They
+   are read again from the process file when restoring, so that the tail of
+   the process file may be changed before resuming.
+
+   Real processes are not saved. A restored process that had been started
+   is re-spawned by replaying its message history when it next runs, as if
+   it had been evicted, so the SHA of every process is unchanged. With the
+   emulated backend the buffer of each process is saved instead.
+
+   Author: David Sha
+============================================================================= */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <inttypes.h>
+#include "checkpoint.h"
+#include "scheduler.h"
+#include "predict.h"
+
+#define CHECKPOINT_MAGIC "PMCKPT12"
+#define CHECKPOINT_MAGIC_LENGTH 8
+#define NO_BLOCK UINT32_MAX
+
+static void write_value(FILE *fp, const void *value, size_t size) {
+    /*  Write a value to a snapshot file.
+     */
+    if (fwrite(value, size, 1, fp) != 1) {
+        perror("fwrite");
+        exit(EXIT_FAILURE);
+    }
+}
+
+static void read_value(FILE *fp, void *value, size_t size) {
+    /*  Read a value from a snapshot file.
+     */
+    if (fread(value, size, 1, fp) != 1) {
+        fprintf(stderr, "Error: Snapshot file is truncated or corrupt\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+static void write_string(FILE *fp, const char *string) {
+    /*  Write a string prefixed by its length.
+     */
+    uint16_t length = (uint16_t)strlen(string);
+    write_value(fp, &length, sizeof(length));
+    if (length) {
+        write_value(fp, string, length);
+    }
+}
+
+static char *read_string(FILE *fp) {
+    /*  Read a string prefixed by its length.
+     */
+    uint16_t length;
+    read_value(fp, &length, sizeof(length));
+    char *string = (char *)malloc(length + 1);
+    assert(string);
+    if (length) {
+        read_value(fp, string, length);
+    }
+    string[length] = '\0';
+    return string;
+}
+
+static uint32_t block_index(list_t *memory, block_t *block) {
+    /*  Return the position of a block in the memory block list.
+     */
+    uint32_t index = 0;
+    for (node_t *curr = memory->head; curr; curr = curr->next, index++) {
+        if (curr->data == block) {
+            return index;
+        }
+    }
+    return NO_BLOCK;
+}
+
+static void save_process(FILE *fp, process_t *process) {
+    /*  Write the history, usage and emulated buffer of a process, if it
+        was created. Rejected processes never are.
+     */
+    uint8_t has_process = process != NULL;
+    write_value(fp, &has_process, sizeof(has_process));
+    if (!has_process) {
+        return;
+    }
+    uint32_t history_len = process->history_len;
+    write_value(fp, &history_len, sizeof(history_len));
+    for (int i = 0; i < process->history_len; i++) {
+        uint8_t op = (uint8_t)process->history[i].op;
+        write_value(fp, &op, sizeof(op));
+        write_value(fp, process->history[i].simulation_time,
+                    BIG_ENDIAN_BYTES);
+    }
+    write_value(fp, &process->usage, sizeof(process->usage));
+    uint8_t has_content = process->content != NULL;
+    write_value(fp, &has_content, sizeof(has_content));
+    if (has_content) {
+        uint32_t index = (uint32_t)process->content_index;
+        write_value(fp, &index, sizeof(index));
+        write_value(fp, process->content, SHA_BUFFER_LENGTH);
+    }
+}
+
+static void save_pages(FILE *fp, pcb_t *pcb) {
+    /*  Write the page table of a process, if it has one, and its page
+        reference state.
+     */
+    uint8_t has_pages = pcb->pages != NULL;
+    write_value(fp, &has_pages, sizeof(has_pages));
+    if (has_pages) {
+        write_value(fp, &pcb->pages->id, sizeof(pcb->pages->id));
+        write_value(fp, &pcb->pages->n_pages, sizeof(pcb->pages->n_pages));
+        write_value(fp, &pcb->pages->resident, sizeof(pcb->pages->resident));
+        write_value(fp, pcb->pages->entries,
+                    pcb->pages->n_pages * sizeof(pte_t));
+    }
+    write_value(fp, &pcb->page_seed, sizeof(pcb->page_seed));
+    write_value(fp, &pcb->stall, sizeof(pcb->stall));
+    write_value(fp, &pcb->page_references, sizeof(pcb->page_references));
+    write_value(fp, &pcb->page_faults, sizeof(pcb->page_faults));
+    write_value(fp, &pcb->max_resident, sizeof(pcb->max_resident));
+}
+
+static void restore_pages(FILE *fp, cycle_t *c, pcb_t *pcb) {
+    /*  Read the page table of a process, if it has one, into the table of
+        page tables of paged memory, and its page reference state.
+     */
+    uint8_t has_pages;
+    read_value(fp, &has_pages, sizeof(has_pages));
+    pcb->pages = NULL;
+    if (has_pages) {
+        page_table_t *table;
+        table = (page_table_t *)malloc(sizeof(*table));
+        assert(table);
+        read_value(fp, &table->id, sizeof(table->id));
+        read_value(fp, &table->n_pages, sizeof(table->n_pages));
+        read_value(fp, &table->resident, sizeof(table->resident));
+        if (!c->paged_memory || table->id >= c->paged_memory->n_tables) {
+            fprintf(stderr, "Error: Snapshot file is truncated or corrupt\n");
+            exit(EXIT_FAILURE);
+        }
+        table->entries = (pte_t *)calloc(
+            table->n_pages ? table->n_pages : 1, sizeof(pte_t));
+        assert(table->entries);
+        read_value(fp, table->entries, table->n_pages * sizeof(pte_t));
+        c->paged_memory->tables[table->id] = table;
+        pcb->pages = table;
+    }
+    read_value(fp, &pcb->page_seed, sizeof(pcb->page_seed));
+    read_value(fp, &pcb->stall, sizeof(pcb->stall));
+    read_value(fp, &pcb->page_references, sizeof(pcb->page_references));
+    read_value(fp, &pcb->page_faults, sizeof(pcb->page_faults));
+    read_value(fp, &pcb->max_resident, sizeof(pcb->max_resident));
+}
+
+static void restore_process(FILE *fp, pcb_t *pcb) {
+    /*  Read the history, usage and emulated buffer of a process, if it
+        was created.
+     */
+    uint8_t has_process;
+    read_value(fp, &has_process, sizeof(has_process));
+    if (!has_process) {
+        pcb->process = NULL;
+        return;
+    }
+    process_t *process = initialise_process(pcb);
+    uint32_t history_len;
+    read_value(fp, &history_len, sizeof(history_len));
+    if (history_len) {
+        process->history =
+            (record_t *)malloc(history_len * sizeof(record_t));
+        assert(process->history);
+        process->history_len = process->history_size = (int)history_len;
+    }
+    for (uint32_t i = 0; i < history_len; i++) {
+        uint8_t op;
+        read_value(fp, &op, sizeof(op));
+        process->history[i].op = (op_t)op;
+        read_value(fp, process->history[i].simulation_time,
+                   BIG_ENDIAN_BYTES);
+    }
+    read_value(fp, &process->usage, sizeof(process->usage));
+    uint8_t has_content;
+    read_value(fp, &has_content, sizeof(has_content));
+    if (has_content) {
+        uint32_t index;
+        read_value(fp, &index, sizeof(index));
+        process->content_index = index;
+        process->content =
+            (uint8_t *)malloc(SHA_BUFFER_LENGTH * sizeof(uint8_t));
+        assert(process->content);
+        read_value(fp, process->content, SHA_BUFFER_LENGTH);
+    }
+}
+
+static void save_queue(FILE *fp, cycle_t *c, list_t *queue) {
+    /*  Write the number of processes in a queue followed by each process.
+     */
+    uint32_t len = (uint32_t)list_len(queue);
+    write_value(fp, &len, sizeof(len));
+    for (node_t *curr = queue->head; curr; curr = curr->next) {
+        pcb_t *pcb = (pcb_t *)curr->data;
+        uint8_t state = (uint8_t)pcb->state;
+        uint32_t memory = block_index(c->memory->blocks, pcb->memory);
+        write_string(fp, pcb->name);
+        write_value(fp, &state, sizeof(state));
+        write_value(fp, &pcb->arrival_time, sizeof(pcb->arrival_time));
+        write_value(fp, &pcb->termination_time,
+                    sizeof(pcb->termination_time));
+        write_value(fp, &pcb->service_time, sizeof(pcb->service_time));
+        write_value(fp, &pcb->remaining_time, sizeof(pcb->remaining_time));
+        write_value(fp, &pcb->memory_size, sizeof(pcb->memory_size));
+        write_value(fp, &memory, sizeof(memory));
+        write_value(fp, &pcb->level, sizeof(pcb->level));
+        write_value(fp, &pcb->slice_used, sizeof(pcb->slice_used));
+        write_value(fp, &pcb->seq, sizeof(pcb->seq));
+        write_value(fp, &pcb->weight, sizeof(pcb->weight));
+        write_string(fp, pcb->tenant);
+        write_string(fp, pcb->command ? pcb->command : "");
+        write_value(fp, &pcb->vruntime, sizeof(pcb->vruntime));
+        write_value(fp, &pcb->deadline, sizeof(pcb->deadline));
+        write_value(fp, &pcb->quantum, sizeof(pcb->quantum));
+        write_value(fp, &pcb->predicted, sizeof(pcb->predicted));
+        write_value(fp, &pcb->priority, sizeof(pcb->priority));
+        write_value(fp, &pcb->admission_time, sizeof(pcb->admission_time));
+        write_value(fp, &pcb->deferred_since, sizeof(pcb->deferred_since));
+        write_value(fp, &pcb->deferred_time, sizeof(pcb->deferred_time));
+        write_value(fp, &pcb->resident_since, sizeof(pcb->resident_since));
+        write_value(fp, &pcb->swap_done, sizeof(pcb->swap_done));
+        save_pages(fp, pcb);
+        save_process(fp, pcb->process);
+    }
+}
+
+static void restore_queue(FILE *fp, cycle_t *c, block_t **blocks,
+                          uint32_t n_blocks, list_t *queue,
+                          list_t *process_table) {
+    /*  Read the processes of a queue and add them to the queue and to the
+        process table, which owns them.
+     */
+    uint32_t len;
+    read_value(fp, &len, sizeof(len));
+    for (uint32_t i = 0; i < len; i++) {
+        pcb_t *pcb;
+        pcb = (pcb_t *)malloc(sizeof(*pcb));
+        assert(pcb);
+        uint8_t state;
+        uint32_t memory;
+        pcb->name = read_string(fp);
+        read_value(fp, &state, sizeof(state));
+        pcb->state = state;
+        read_value(fp, &pcb->arrival_time, sizeof(pcb->arrival_time));
+        read_value(fp, &pcb->termination_time,
+                   sizeof(pcb->termination_time));
+        read_value(fp, &pcb->service_time, sizeof(pcb->service_time));
+        read_value(fp, &pcb->remaining_time, sizeof(pcb->remaining_time));
+        read_value(fp, &pcb->memory_size, sizeof(pcb->memory_size));
+        read_value(fp, &memory, sizeof(memory));
+        if (memory != NO_BLOCK && memory >= n_blocks) {
+            fprintf(stderr, "Error: Snapshot file is truncated or corrupt\n");
+            exit(EXIT_FAILURE);
+        }
+        pcb->memory = memory == NO_BLOCK ? NULL : blocks[memory];
+        read_value(fp, &pcb->level, sizeof(pcb->level));
+        read_value(fp, &pcb->slice_used, sizeof(pcb->slice_used));
+        read_value(fp, &pcb->seq, sizeof(pcb->seq));
+        read_value(fp, &pcb->weight, sizeof(pcb->weight));
+        pcb->tenant = read_string(fp);
+        pcb->command = read_string(fp);
+        if (!*pcb->command) {
+            free(pcb->command);
+            pcb->command = NULL;
+        }
+        read_value(fp, &pcb->vruntime, sizeof(pcb->vruntime));
+        read_value(fp, &pcb->deadline, sizeof(pcb->deadline));
+        read_value(fp, &pcb->quantum, sizeof(pcb->quantum));
+        read_value(fp, &pcb->predicted, sizeof(pcb->predicted));
+        read_value(fp, &pcb->priority, sizeof(pcb->priority));
+        read_value(fp, &pcb->admission_time, sizeof(pcb->admission_time));
+        read_value(fp, &pcb->deferred_since, sizeof(pcb->deferred_since));
+        read_value(fp, &pcb->deferred_time, sizeof(pcb->deferred_time));
+        read_value(fp, &pcb->resident_since, sizeof(pcb->resident_since));
+        read_value(fp, &pcb->swap_done, sizeof(pcb->swap_done));
+        if (pcb->level < 0 || (c->n_levels && pcb->level >= c->n_levels)) {
+            fprintf(stderr,
+                    "Error: Snapshot was taken with other -L levels\n");
+            exit(EXIT_FAILURE);
+        }
+        restore_pages(fp, c, pcb);
+        restore_process(fp, pcb);
+        append(queue, pcb);
+        append(process_table, pcb);
+    }
+}
+
+void save_checkpoint(cycle_t *c, char *file) {
+    /*  Write a snapshot of the simulation to a file. The snapshot is written
+        to a temporary file first and then renamed, so that an existing
+        snapshot is never left half written.
+     */
+    char *temp = (char *)malloc(strlen(file) + 5);
+    assert(temp);
+    sprintf(temp, "%s.tmp", file);
+    FILE *fp = fopen(temp, "wb");
+    if (!fp) {
+        perror(temp);
+        exit(EXIT_FAILURE);
+    }
+
+    // header and the arguments the snapshot must be resumed with
+    write_value(fp, CHECKPOINT_MAGIC, CHECKPOINT_MAGIC_LENGTH);
+    write_string(fp, c->args->scheduler);
+    write_string(fp, c->args->memory);
+    write_string(fp, c->args->quantum);
+    write_string(fp, c->args->replacement);
+    uint8_t emulated = strcmp(c->args->backend, EMULATED) == 0;
+    write_value(fp, &emulated, sizeof(emulated));
+
+    // simulation time and statistics accumulators
+    write_value(fp, &c->simulation_time, sizeof(c->simulation_time));
+    write_value(fp, &c->quantum, sizeof(c->quantum));
+    write_value(fp, &c->context_switches, sizeof(c->context_switches));
+    write_value(fp, &c->arrived_until, sizeof(c->arrived_until));
+    write_value(fp, &c->cycles, sizeof(c->cycles));
+    write_value(fp, &c->total_latency, sizeof(c->total_latency));
+    write_value(fp, &c->max_latency, sizeof(c->max_latency));
+    write_value(fp, &c->max_input_len, sizeof(c->max_input_len));
+    write_value(fp, &c->swap_busy_until, sizeof(c->swap_busy_until));
+    write_value(fp, &c->swap_busy, sizeof(c->swap_busy));
+    write_value(fp, &c->swap_delay, sizeof(c->swap_delay));
+    write_value(fp, &c->swap_outs, sizeof(c->swap_outs));
+    write_value(fp, &c->swap_ins, sizeof(c->swap_ins));
+    write_value(fp, &c->swapped_out, sizeof(c->swapped_out));
+    write_value(fp, &c->swapped_in, sizeof(c->swapped_in));
+
+    // scheduler state
+    write_value(fp, &c->next_boost, sizeof(c->next_boost));
+    write_value(fp, &c->ready_seq, sizeof(c->ready_seq));
+    write_value(fp, &c->preemptions, sizeof(c->preemptions));
+    write_value(fp, &c->min_vruntime, sizeof(c->min_vruntime));
+    settle_tenants(c);
+    uint32_t n_tenants = (uint32_t)list_len(c->tenants);
+    write_value(fp, &n_tenants, sizeof(n_tenants));
+    for (node_t *curr = c->tenants->head; curr; curr = curr->next) {
+        tenant_t *tenant = (tenant_t *)curr->data;
+        write_string(fp, tenant->name);
+        write_value(fp, &tenant->processes, sizeof(tenant->processes));
+        write_value(fp, &tenant->runnable_weight,
+                    sizeof(tenant->runnable_weight));
+        write_value(fp, &tenant->received, sizeof(tenant->received));
+        write_value(fp, &tenant->entitled, sizeof(tenant->entitled));
+    }
+    write_value(fp, &c->estimate, sizeof(c->estimate));
+    uint32_t n_history = (uint32_t)list_len(c->history);
+    write_value(fp, &n_history, sizeof(n_history));
+    for (node_t *curr = c->history->head; curr; curr = curr->next) {
+        history_t *history = (history_t *)curr->data;
+        write_string(fp, history->name);
+        write_value(fp, &history->estimate, sizeof(history->estimate));
+    }
+
+    // memory block list
+    uint32_t n_blocks = (uint32_t)list_len(c->memory->blocks);
+    write_value(fp, &n_blocks, sizeof(n_blocks));
+    for (node_t *curr = c->memory->blocks->head; curr; curr = curr->next) {
+        block_t *block = (block_t *)curr->data;
+        uint8_t status = (uint8_t)block->status;
+        write_value(fp, &status, sizeof(status));
+        write_value(fp, &block->location, sizeof(block->location));
+        write_value(fp, &block->size, sizeof(block->size));
+    }
+
+    // frame table of paged memory, whose page tables are saved with their
+    // processes
+    if (c->paged_memory) {
+        paged_memory_t *pm = c->paged_memory;
+        write_value(fp, &pm->n_frames, sizeof(pm->n_frames));
+        write_value(fp, pm->frames, pm->n_frames * sizeof(frame_t));
+        write_value(fp, pm->lists, sizeof(pm->lists));
+        write_value(fp, &pm->hand, sizeof(pm->hand));
+        write_value(fp, &pm->ghost_head, sizeof(pm->ghost_head));
+        write_value(fp, &pm->n_ghosts, sizeof(pm->n_ghosts));
+        write_value(fp, pm->ghost_owners, pm->max_ghosts * sizeof(uint32_t));
+        write_value(fp, pm->ghost_pages, pm->max_ghosts * sizeof(uint32_t));
+        write_value(fp, &pm->n_tables, sizeof(pm->n_tables));
+        write_value(fp, &pm->evictions, sizeof(pm->evictions));
+    }
+
+    // every process that has arrived, queue by queue
+    save_queue(fp, c, c->input_queue);
+    save_queue(fp, c, c->ready_queue);
+    save_queue(fp, c, c->running_queue);
+    save_queue(fp, c, c->finished_queue);
+    save_queue(fp, c, c->rejected_queue);
+    save_queue(fp, c, c->swapped_queue);
+
+    // processes that have arrived but are held back by backpressure, which
+    // are at the head of the submitted queue
+    list_t *held = create_empty_list();
+    for (node_t *curr = c->submitted_queue->head; curr; curr = curr->next) {
+        pcb_t *pcb = (pcb_t *)curr->data;
+        if (pcb->arrival_time > c->arrived_until) {
+            break;
+        }
+        append(held, pcb);
+    }
+    save_queue(fp, c, held);
+    free_list(held, NULL);
+
+    if (fclose(fp) == EOF) {
+        perror("fclose");
+        exit(EXIT_FAILURE);
+    }
+    if (rename(temp, file) == FAILED) {
+        perror("rename");
+        exit(EXIT_FAILURE);
+    }
+    free(temp);
+}
+
+void restore_checkpoint(cycle_t *c, char *file, list_t *process_table) {
+    /*  Restore a snapshot of the simulation from a file into an empty cycle.
+        Processes in the process table that had arrived when the snapshot
+        was taken are replaced by the ones in the snapshot, and the rest are
+        added to the submitted queue.
+     */
+    FILE *fp = fopen(file, "rb");
+    if (!fp) {
+        perror(file);
+        exit(EXIT_FAILURE);
+    }
+
+    // check the header and that the arguments match
+    char magic[CHECKPOINT_MAGIC_LENGTH];
+    read_value(fp, magic, CHECKPOINT_MAGIC_LENGTH);
+    if (memcmp(magic, CHECKPOINT_MAGIC, CHECKPOINT_MAGIC_LENGTH) != 0) {
+        fprintf(stderr, "Error: %s is not a snapshot file\n", file);
+        exit(EXIT_FAILURE);
+    }
+    char *scheduler = read_string(fp);
+    char *memory = read_string(fp);
+    char *quantum = read_string(fp);
+    char *replacement = read_string(fp);
+    uint8_t emulated;
+    read_value(fp, &emulated, sizeof(emulated));
+    int is_emulated = strcmp(c->args->backend, EMULATED) == 0;
+    if (strcmp(scheduler, c->args->scheduler) != 0 ||
+        strcmp(memory, c->args->memory) != 0 ||
+        strcmp(quantum, c->args->quantum) != 0 ||
+        (c->paged_memory &&
+         strcmp(replacement, c->args->replacement) != 0) ||
+        emulated != is_emulated) {
+        fprintf(stderr,
+                "Error: Snapshot was taken with -s %s -m %s -q %s -P %s%s\n",
+                scheduler, memory, quantum, replacement,
+                emulated ? " -b emulated" : "");
+        exit(EXIT_FAILURE);
+    }
+    free(scheduler);
+    free(memory);
+    free(quantum);
+    free(replacement);
+
+    // simulation time and statistics accumulators
+    read_value(fp, &c->simulation_time, sizeof(c->simulation_time));
+    read_value(fp, &c->quantum, sizeof(c->quantum));
+    read_value(fp, &c->context_switches, sizeof(c->context_switches));
+    read_value(fp, &c->arrived_until, sizeof(c->arrived_until));
+    read_value(fp, &c->cycles, sizeof(c->cycles));
+    read_value(fp, &c->total_latency, sizeof(c->total_latency));
+    read_value(fp, &c->max_latency, sizeof(c->max_latency));
+    read_value(fp, &c->max_input_len, sizeof(c->max_input_len));
+    read_value(fp, &c->swap_busy_until, sizeof(c->swap_busy_until));
+    read_value(fp, &c->swap_busy, sizeof(c->swap_busy));
+    read_value(fp, &c->swap_delay, sizeof(c->swap_delay));
+    read_value(fp, &c->swap_outs, sizeof(c->swap_outs));
+    read_value(fp, &c->swap_ins, sizeof(c->swap_ins));
+    read_value(fp, &c->swapped_out, sizeof(c->swapped_out));
+    read_value(fp, &c->swapped_in, sizeof(c->swapped_in));
+
+    // scheduler state
+    read_value(fp, &c->next_boost, sizeof(c->next_boost));
+    read_value(fp, &c->ready_seq, sizeof(c->ready_seq));
+    read_value(fp, &c->preemptions, sizeof(c->preemptions));
+    read_value(fp, &c->min_vruntime, sizeof(c->min_vruntime));
+    uint32_t n_tenants;
+    read_value(fp, &n_tenants, sizeof(n_tenants));
+    for (uint32_t i = 0; i < n_tenants; i++) {
+        char *name = read_string(fp);
+        tenant_t *tenant = find_tenant(c, name);
+        free(name);
+        read_value(fp, &tenant->processes, sizeof(tenant->processes));
+        read_value(fp, &tenant->runnable_weight,
+                   sizeof(tenant->runnable_weight));
+        read_value(fp, &tenant->received, sizeof(tenant->received));
+        read_value(fp, &tenant->entitled, sizeof(tenant->entitled));
+    }
+    read_value(fp, &c->estimate, sizeof(c->estimate));
+    uint32_t n_history;
+    read_value(fp, &n_history, sizeof(n_history));
+    for (uint32_t i = 0; i < n_history; i++) {
+        char *name = read_string(fp);
+        history_t *history = find_history(c, name);
+        free(name);
+        read_value(fp, &history->estimate, sizeof(history->estimate));
+    }
+
+    // memory block list
+    uint32_t n_blocks;
+    read_value(fp, &n_blocks, sizeof(n_blocks));
+    block_t **blocks = (block_t **)malloc((n_blocks + 1) * sizeof(block_t *));
+    assert(blocks);
+    mm_clear(c->memory);
+    for (uint32_t i = 0; i < n_blocks; i++) {
+        uint8_t status;
+        uint16_t location, size;
+        read_value(fp, &status, sizeof(status));
+        read_value(fp, &location, sizeof(location));
+        read_value(fp, &size, sizeof(size));
+        blocks[i] = create_memory_block(status, location, size);
+        mm_append(c->memory, blocks[i]);
+    }
+
+    // frame table of paged memory, whose page tables are restored with
+    // their processes
+    if (c->paged_memory) {
+        paged_memory_t *pm = c->paged_memory;
+        uint32_t n_frames;
+        read_value(fp, &n_frames, sizeof(n_frames));
+        if (n_frames != pm->n_frames) {
+            fprintf(stderr, "Error: Snapshot was taken with other frames\n");
+            exit(EXIT_FAILURE);
+        }
+        read_value(fp, pm->frames, pm->n_frames * sizeof(frame_t));
+        read_value(fp, pm->lists, sizeof(pm->lists));
+        read_value(fp, &pm->hand, sizeof(pm->hand));
+        read_value(fp, &pm->ghost_head, sizeof(pm->ghost_head));
+        read_value(fp, &pm->n_ghosts, sizeof(pm->n_ghosts));
+        read_value(fp, pm->ghost_owners, pm->max_ghosts * sizeof(uint32_t));
+        read_value(fp, pm->ghost_pages, pm->max_ghosts * sizeof(uint32_t));
+        read_value(fp, &pm->n_tables, sizeof(pm->n_tables));
+        read_value(fp, &pm->evictions, sizeof(pm->evictions));
+        pm->tables_size = pm->n_tables + 1;
+        pm->tables =
+            (page_table_t **)calloc(pm->tables_size, sizeof(page_table_t *));
+        assert(pm->tables);
+    }
+
+    // processes that had not arrived are taken from the process file
+    node_t *curr = process_table->head;
+    while (curr) {
+        node_t *next = curr->next;
+        pcb_t *pcb = (pcb_t *)curr->data;
+        if (pcb->arrival_time > c->arrived_until) {
+            append(c->submitted_queue, pcb);
+        } else {
+            remove_node(process_table, curr);
+            free_pcb(pcb);
+        }
+        curr = next;
+    }
+
+    // every process that had arrived, queue by queue
+    restore_queue(fp, c, blocks, n_blocks, c->input_queue, process_table);
+    restore_queue(fp, c, blocks, n_blocks, c->ready_queue, process_table);
+    for (node_t *curr = c->ready_queue->head; curr; curr = curr->next) {
+        ((pcb_t *)curr->data)->ready_node = curr;
+    }
+    restore_queue(fp, c, blocks, n_blocks, c->running_queue, process_table);
+    restore_queue(fp, c, blocks, n_blocks, c->finished_queue, process_table);
+    restore_queue(fp, c, blocks, n_blocks, c->rejected_queue, process_table);
+    restore_queue(fp, c, blocks, n_blocks, c->swapped_queue, process_table);
+
+    // processes held back by backpressure go back to the head of the
+    // submitted queue, in order
+    list_t *held = create_empty_list();
+    restore_queue(fp, c, blocks, n_blocks, held, process_table);
+    while (!is_empty_list(held)) {
+        prepend(c->submitted_queue, held->foot->data);
+        remove_node(held, held->foot);
+    }
+    free_list(held, NULL);
+
+    free(blocks);
+    fclose(fp);
+}
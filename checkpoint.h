@@ -0,0 +1,19 @@
+/* =============================================================================
+   checkpoint.h
+
+   Checkpoint and restore of the full state of a simulation, so that a long
+   simulation can be resumed from a snapshot file instead of time zero.
+
+   Author: David Sha
+============================================================================= */
+#ifndef _CHECKPOINT_H_
+#define _CHECKPOINT_H_
+
+/* #includes ================================================================ */
+#include "main.h"
+
+/* function prototypes ====================================================== */
+void save_checkpoint(cycle_t *c, char *file);
+void restore_checkpoint(cycle_t *c, char *file, list_t *process_table);
+
+#endif
@@ -18,14 +18,36 @@
  */
 #define SJF "SJF"
 #define RR "RR"
+#define MLFQ "MLFQ"
+#define SRTF "SRTF"
+#define CFS "CFS"
+#define EDF "EDF"
+#define SJF_EST "SJF-EST"
+#define ADAPTIVE "adaptive"
+#define FIFO "fifo"
+#define RESERVE "reserve"
+#define SMALLEST "smallest"
+#define LARGEST "largest"
 #define INFINITE "infinite"
 #define BESTFIT "best-fit"
+#define PAGED "paged"
+#define LRU "LRU"
+#define CLOCK "CLOCK"
+#define TWO_Q "2Q"
+#define BLOCKING "blocking"
+#define URING "io_uring"
+#define EMULATED "emulated"
+#define FLOAT "float"
+#define SPREAD "spread"
+#define PACK "pack"
 
 /*  Separator for parsing input files.
  */
 #define SEPARATOR " "
 
 /*  Configure debug mode. Lots of useful information will be printed to stdout.
+    To find where time goes, use the `-p` flag instead, which costs nothing
+    when it is not given.
  */
 #define DEBUG 0
 
@@ -35,14 +57,201 @@
  */
 #define MAX_MEMORY 2048
 
-/*  Enables task4 (real process). Comment out to disable.
+/*  Backend used to control processes when no `-b` flag is given. Set to
+    EMULATED to produce the same transcript without real processes.
  */
-#define IMPLEMENTS_REAL_PROCESS
+#define DEFAULT_BACKEND BLOCKING
+
+/*  Quanta of each level of the MLFQ scheduler in cycles, from the highest
+    priority level to the lowest, unless given by the `-L` flag.
+ */
+#define MLFQ_QUANTA "1,2,4"
+
+/*  Period in seconds of simulation time at which the MLFQ scheduler moves
+    every process back to the highest priority level, unless given by the
+    `-B` flag. 0 disables boosting.
+ */
+#define MLFQ_BOOST_PERIOD 100
+
+/*  Adaptive quantum (`-q adaptive`). Each cycle lasts long enough for the
+    given percentile of ready processes to finish, but short enough that
+    every ready process runs within the target latency, and is clamped to
+    the given minimum and maximum. The minimum is used while idle so that
+    arrivals are not delayed.
+ */
+#define ADAPTIVE_PERCENTILE 80
+#define ADAPTIVE_TARGET_LATENCY 48
+#define ADAPTIVE_MIN_QUANTUM 1
+#define ADAPTIVE_MAX_QUANTUM 10
+
+/*  Service time prediction for SJF-EST. Each new service time is weighted
+    by PREDICT_ALPHA in the exponential averages, and a process is predicted
+    to run for PREDICT_INITIAL_ESTIMATE seconds before any has finished.
+ */
+#define PREDICT_ALPHA 0.5
+#define PREDICT_INITIAL_ESTIMATE 10
+
+/*  Deadline of a process that has no deadline field in the input file.
+ */
+#define NO_DEADLINE UINT32_MAX
+
+/*  Admission policy of best-fit when no `-A` flag is given: admit every
+    process in the input queue that fits, in the order of the input file.
+ */
+#define DEFAULT_ADMISSION FIFO
+
+/*  Time a process was first held back from the full input queue, if it
+    never was.
+ */
+#define NOT_DEFERRED UINT32_MAX
+
+/*  Swapping (`-S`). Moving a process to or from the backing store takes
+    SWAP_LATENCY milliseconds plus its memory size over SWAP_BANDWIDTH in
+    MB per second, one transfer at a time. A process must have been in
+    memory for SWAP_MIN_RESIDENCE seconds before it may be swapped out, so
+    that processes are not swapped back and forth.
+ */
+#define SWAP_LATENCY 5
+#define SWAP_BANDWIDTH 200
+#define SWAP_MIN_RESIDENCE 10
+
+/*  Paged memory (`-m paged`). Memory is divided into frames of PAGE_SIZE,
+    and pages are evicted by DEFAULT_REPLACEMENT unless given by the `-P`
+    flag. 2Q keeps pages seen once in a FIFO of TWO_Q_IN_PERCENT of the
+    frames, and remembers evicted ones for TWO_Q_OUT_PERCENT of the frames.
+ */
+#define PAGE_SIZE 4
+#define DEFAULT_REPLACEMENT LRU
+#define TWO_Q_IN_PERCENT 25
+#define TWO_Q_OUT_PERCENT 50
+
+/*  Page references of a running process. A process references
+    PAGE_REFERENCES pages for every second it runs, PAGE_HOT_PERCENT of them
+    in the first PAGE_HOT_SET_PERCENT of its pages, and the rest anywhere.
+    Each page fault stalls the process for PAGE_FAULT_COST milliseconds of
+    its cycle, which must be less than 1000 / PAGE_REFERENCES for every
+    process to make progress.
+ */
+#define PAGE_REFERENCES 32
+#define PAGE_HOT_PERCENT 80
+#define PAGE_HOT_SET_PERCENT 20
+#define PAGE_FAULT_COST 10
+
+/*  Weight of a process that has no weight field in the input file. A
+    process with twice the weight gets twice the CPU under CFS.
+ */
+#define DEFAULT_WEIGHT 1
+
+/*  Virtual runtime charged to a process of DEFAULT_WEIGHT per second it
+    runs under CFS. Larger values lose less precision for large weights.
+ */
+#define CFS_WEIGHT_SCALE 1024
+
+/*  Minimum number of cycles a process runs under CFS before a process with
+    a smaller virtual runtime may preempt it.
+ */
+#define CFS_MIN_GRANULARITY 1
+
+/*  Size in bytes of the buffer through which a trace is written with the
+    `-T` flag.
+ */
+#define TRACE_BUFFER_SIZE (1 << 20)
+
+/*  Wall time in milliseconds between cycles of the daemon started with the
+    `-D` flag. Every cycle advances simulation time by the quantum.
+ */
+#define DAEMON_CYCLE_MS 10
+
+/*  Maximum number of connections waiting to be accepted by the daemon.
+ */
+#define DAEMON_BACKLOG 4096
+
+/*  Maximum number of events handled per `epoll_wait()` by the daemon.
+ */
+#define DAEMON_EVENTS 256
+
+/*  Maximum length of a request to the daemon, including its newline.
+ */
+#define DAEMON_LINE_LENGTH 256
+
+/*  Number of cycles between snapshots written with the `-c` flag, unless
+    given by the `-k` flag.
+ */
+#define CHECKPOINT_INTERVAL 1000
+
+/*  Maximum number of real processes that may be alive at the same time.
+    Can be lowered with the `-l` flag. Suspended processes over the limit
+    are killed and replayed from their message history when resumed.
+ */
+#define MAX_LIVE_PROCESSES 256
+
+/*  Maximum number of messages written to a re-spawned process in one
+    batch when replaying its message history.
+ */
+#define REPLAY_BATCH 1024
+
+/*  File descriptors kept free for the manager itself when limiting the
+    number of live processes by RLIMIT_NOFILE.
+ */
+#define RESERVED_FDS 16
+
+/*  Maximum number of pipe reads and writes submitted to io_uring in one
+    batch by the io_uring backend.
+ */
+#define URING_ENTRIES 64
+
+/*  Maximum number of events handled per `epoll_wait()` by the reaper.
+ */
+#define REAPER_EVENTS 64
+
+/*  Pid of a process that has not been spawned or has been evicted.
+ */
+#define NOT_SPAWNED 0
 
 /*  Process executable file name.
  */
 #define PROCESS_EXECUTABLE "./process"
 
+/*  cgroup v2 control (`-G`). The manager creates a group named
+    CGROUP_PREFIX followed by its pid, with a group for every process.
+    Groups are limited to CGROUP_CPU_MAX, one CPU, and a process gets
+    CGROUP_CPU_WEIGHT for every unit of its weight, up to the largest
+    weight cgroups allow.
+ */
+#define CGROUP_PREFIX "allocate-"
+#define CGROUP_CPU_MAX "100000 100000"
+#define CGROUP_CPU_WEIGHT 100
+#define CGROUP_MAX_CPU_WEIGHT 10000
+
+/*  CPU placement (`-C`). CPU of a process that is not pinned to one, and
+    the maximum number of NUMA nodes looked for.
+ */
+#define NO_CPU -1
+#define PLACEMENT_MAX_NODES 64
+
+/*  Optional last field of a line of the input file giving the command that
+    runs instead of the process executable, and the shell that runs it.
+ */
+#define COMMAND_FIELD "command="
+#define COMMAND_SHELL "/bin/sh"
+
+/*  Suffix of the log file that captures the output of a command, named
+    after its process in the working directory.
+ */
+#define COMMAND_LOG_SUFFIX ".log"
+
+/*  Maximum number of bytes of output moved to a log per `splice()`, and
+    the size requested for the pipe of a command. Output is only moved
+    between cycles, so a command that writes more than fits in its pipe
+    waits for the next cycle.
+ */
+#define COMMAND_SPLICE_BYTES 65536
+#define COMMAND_PIPE_SIZE (1 << 20)
+
+/*  Milliseconds a terminated command may take to exit before it is killed.
+ */
+#define COMMAND_KILL_TIMEOUT 1000
+
 /*  Number of Big Endian bytes.
  */
 #define BIG_ENDIAN_BYTES 4
@@ -51,4 +260,10 @@
  */
 #define SHA256_LENGTH 64
 
+/*  Size of the buffer that the process executable hashes, and the number
+    of its bytes that are used.
+ */
+#define SHA_BUFFER_LENGTH 128
+#define SHA_CONTENT_LENGTH (128 - 9)
+
 #endif
@@ -0,0 +1,808 @@
+/* =============================================================================
+   daemon.c
+
+   Daemon mode of the process manager. Instead of reading the processes from
+   a file, the manager listens on a Unix domain socket and runs a cycle every
+   DAEMON_CYCLE_MS milliseconds of wall time. Clients send one request per
+   line and receive one reply per line, starting with `OK` or `ERROR`:
+
+   - SUBMIT <name> <service time> <memory size> [<key>=<value>]...
+     submits a process that arrives at the current simulation time, with
+     the same optional fields as the input file
+   - CANCEL <name>
+     cancels a process that has not started, moving it to the rejected
+     queue
+   - STATUS <name>
+     reports the state of a process
+   - STATS
+     reports the counts of processes and the scheduling latency so far
+   - SHUTDOWN
+     stops accepting connections, runs until every process has finished
+     and prints the statistics
+
+   All sockets are non-blocking and driven by a single epoll instance, which
+   waits for at most the time left until the next cycle. When there are no
+   processes the daemon sleeps until a request arrives, and simulation time
+   then catches up with the cycles that were skipped.
+
+   The scheduling latency of a process is the wall time from its submission
+   until it first runs.
+
+   Author: David Sha
+============================================================================= */
+#define _GNU_SOURCE // for accept4()
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "config.h"
+#include "daemon.h"
+#include "scheduler.h"
+#include "trace.h"
+
+#define NS_PER_MS 1000000ULL
+
+// optional fields of a submission, as in the input file
+static const char *const FIELDS[] = {"weight", "deadline", "quantum", "tenant",
+                                     NULL};
+
+static uint64_t wall_clock() {
+    /*  Return the monotonic wall time in nanoseconds.
+     */
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+void raise_fd_limit() {
+    /*  Raise the soft limit on open files to the hard limit, so that the
+        daemon can serve as many clients as the system allows. Called
+        before the number of live processes is limited by the same limit.
+     */
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == FAILED ||
+        limit.rlim_cur == limit.rlim_max) {
+        return;
+    }
+    limit.rlim_cur = limit.rlim_max;
+    if (setrlimit(RLIMIT_NOFILE, &limit) == FAILED) {
+        perror("setrlimit");
+    }
+}
+
+static int cmp_name(void *a, void *b) {
+    /*  Compare two processes by name.
+     */
+    return strcmp(((pcb_t *)a)->name, ((pcb_t *)b)->name);
+}
+
+static void watch_fd(server_t *s, int op, int fd, uint32_t events,
+                     void *ptr) {
+    /*  Add or modify the events of a file descriptor in the epoll instance.
+     */
+    struct epoll_event event = {.events = events, .data.ptr = ptr};
+    if (epoll_ctl(s->epoll_fd, op, fd, &event) == FAILED) {
+        perror("epoll_ctl");
+        exit(EXIT_FAILURE);
+    }
+}
+
+static int listen_socket(char *path) {
+    /*  Create a non-blocking Unix domain socket listening at `path`. A
+        socket left behind by a previous daemon is replaced.
+     */
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Error: Socket path %s is too long\n", path);
+        exit(EXIT_FAILURE);
+    }
+    strcpy(addr.sun_path, path);
+    struct stat st;
+    if (stat(path, &st) == 0 && S_ISSOCK(st.st_mode)) {
+        unlink(path);
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd == FAILED) {
+        perror("socket");
+        exit(EXIT_FAILURE);
+    }
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == FAILED) {
+        perror(path);
+        exit(EXIT_FAILURE);
+    }
+    if (listen(fd, DAEMON_BACKLOG) == FAILED) {
+        perror("listen");
+        exit(EXIT_FAILURE);
+    }
+    return fd;
+}
+
+static int signal_socket() {
+    /*  Return a signalfd for SIGINT and SIGTERM, which shut the daemon down
+        like a SHUTDOWN request.
+     */
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+    if (sigprocmask(SIG_BLOCK, &mask, NULL) == FAILED) {
+        perror("sigprocmask");
+        exit(EXIT_FAILURE);
+    }
+    int fd = signalfd(FAILED, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (fd == FAILED) {
+        perror("signalfd");
+        exit(EXIT_FAILURE);
+    }
+    return fd;
+}
+
+static server_t *create_server(args_t *args) {
+    /*  Create the simulation and start listening for clients.
+     */
+    server_t *s;
+    s = (server_t *)malloc(sizeof(*s));
+    assert(s);
+    s->c = create_cycle(args);
+    s->process_table = create_empty_list();
+    s->names = create_rbtree(cmp_name);
+    s->clients = create_empty_list();
+
+    // leave the file descriptors that real processes may need
+    struct rlimit limit;
+    int live = args->live ? atoi(args->live) : MAX_LIVE_PROCESSES;
+    if (strcmp(args->backend, EMULATED) == 0) {
+        live = 0;
+    }
+    s->max_clients = INT32_MAX;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 &&
+        limit.rlim_cur != RLIM_INFINITY) {
+        s->max_clients = (int)limit.rlim_cur - RESERVED_FDS - 2 * live;
+        if (s->max_clients < 1) {
+            s->max_clients = 1;
+        }
+    }
+    s->n_clients = 0;
+    s->peak_clients = 0;
+    s->accepted = 0;
+    s->refused = 0;
+    s->submissions = 0;
+    s->cancellations = 0;
+    s->draining = FALSE;
+    s->first_submit = 0;
+    s->last_submit = 0;
+    s->next_cycle = 0;
+    s->latencies = NULL;
+    s->n_latencies = 0;
+    s->latencies_size = 0;
+
+    s->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (s->epoll_fd == FAILED) {
+        perror("epoll_create1");
+        exit(EXIT_FAILURE);
+    }
+    s->listen_fd = listen_socket(args->daemon);
+    s->signal_fd = signal_socket();
+    watch_fd(s, EPOLL_CTL_ADD, s->listen_fd, EPOLLIN, &s->listen_fd);
+    watch_fd(s, EPOLL_CTL_ADD, s->signal_fd, EPOLLIN, &s->signal_fd);
+    return s;
+}
+
+static int is_idle(server_t *s) {
+    /*  Return whether every process has finished or been rejected, without
+        counting them.
+     */
+    cycle_t *c = s->c;
+    return !mpsc_depth(c->arrivals) && !c->submitted_queue->head &&
+           !c->input_queue->head &&
+           !c->ready_queue->head && !c->running_queue->head &&
+           !c->swapped_queue->head;
+}
+
+static void stop_listening(server_t *s) {
+    /*  Close the listening socket so that no more clients connect.
+     */
+    if (s->listen_fd == FAILED) {
+        return;
+    }
+    close(s->listen_fd);
+    s->listen_fd = FAILED;
+    unlink(s->c->args->daemon);
+}
+
+static void close_client(server_t *s, client_t *client) {
+    /*  Disconnect a client, dropping any reply it has not read.
+     */
+    remove_node(s->clients, client->node);
+    s->n_clients--;
+    close(client->fd);
+    free(client->out);
+    free(client);
+}
+
+static void flush_client(server_t *s, client_t *client) {
+    /*  Send as much of the buffered replies to a client as its socket
+        accepts, and wait for it to become writable if some are left.
+     */
+    size_t sent = 0;
+    while (sent < client->out_len) {
+        ssize_t n = send(client->fd, client->out + sent, client->out_len - sent,
+                         MSG_NOSIGNAL);
+        if (n == FAILED) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                // the client is gone, which its socket reports as readable
+                sent = client->out_len;
+            }
+            break;
+        }
+        sent += (size_t)n;
+    }
+    memmove(client->out, client->out + sent, client->out_len - sent);
+    client->out_len -= sent;
+    int writing = client->out_len > 0;
+    if (writing != client->writing) {
+        watch_fd(s, EPOLL_CTL_MOD, client->fd,
+                 EPOLLIN | EPOLLRDHUP | (writing ? EPOLLOUT : 0), client);
+        client->writing = writing;
+    }
+}
+
+static void reply(server_t *s, client_t *client, const char *format, ...) {
+    /*  Send a reply of one line to a client, buffering what cannot be sent
+        yet.
+     */
+    char line[DAEMON_LINE_LENGTH];
+    va_list ap;
+    va_start(ap, format);
+    int len = vsnprintf(line, sizeof(line) - 1, format, ap);
+    va_end(ap);
+    if (len < 0) {
+        return;
+    }
+    if ((size_t)len > sizeof(line) - 2) {
+        len = sizeof(line) - 2;
+    }
+    line[len++] = '\n';
+    if (client->out_len + len > client->out_size) {
+        client->out_size = (client->out_len + len) * 2;
+        client->out = (char *)realloc(client->out, client->out_size);
+        assert(client->out);
+    }
+    memcpy(client->out + client->out_len, line, len);
+    client->out_len += len;
+    if (!client->writing) {
+        flush_client(s, client);
+    }
+}
+
+static void accept_clients(server_t *s) {
+    /*  Accept every pending connection. Clients over the limit of open
+        files are told so and disconnected.
+     */
+    while (s->listen_fd != FAILED) {
+        int fd =
+            accept4(s->listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd == FAILED) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EMFILE &&
+                errno != ENFILE) {
+                perror("accept4");
+                exit(EXIT_FAILURE);
+            }
+            return;
+        }
+        if (s->n_clients >= s->max_clients) {
+            const char busy[] = "ERROR busy\n";
+            send(fd, busy, sizeof(busy) - 1, MSG_NOSIGNAL);
+            close(fd);
+            s->refused++;
+            continue;
+        }
+        client_t *client;
+        client = (client_t *)malloc(sizeof(*client));
+        assert(client);
+        client->fd = fd;
+        client->in_len = 0;
+        client->out = NULL;
+        client->out_len = 0;
+        client->out_size = 0;
+        client->writing = FALSE;
+        append(s->clients, client);
+        client->node = s->clients->foot;
+        watch_fd(s, EPOLL_CTL_ADD, fd, EPOLLIN | EPOLLRDHUP, client);
+        s->accepted++;
+        if (++s->n_clients > s->peak_clients) {
+            s->peak_clients = s->n_clients;
+        }
+    }
+}
+
+static pcb_t *find_process(server_t *s, char *name) {
+    /*  Return the submitted process with the given name, or NULL.
+     */
+    pcb_t key = {.name = name};
+    return (pcb_t *)rbtree_find(s->names, &key);
+}
+
+static const char *process_state(pcb_t *pcb) {
+    /*  Return the name of the state of a process.
+     */
+    switch (pcb->state) {
+    case NEW:
+        if (pcb->process) {
+            return "input";
+        }
+        return pcb->deferred_since != NOT_DEFERRED ? "deferred" : "submitted";
+    case READY:
+        return "ready";
+    case RUNNING:
+        return "running";
+    case SUSPENDED:
+        return "suspended";
+    default:
+        return pcb->remaining_time ? "rejected" : "finished";
+    }
+}
+
+static int parse_number(char *token, uint32_t min, uint32_t max,
+                        uint32_t *value) {
+    /*  Parse a decimal number between `min` and `max`. Return whether it
+        was valid.
+     */
+    if (!token || *token < '0' || *token > '9') {
+        return FALSE;
+    }
+    char *end;
+    errno = 0;
+    unsigned long number = strtoul(token, &end, 10);
+    if (errno || *end || number < min || number > max) {
+        return FALSE;
+    }
+    *value = (uint32_t)number;
+    return TRUE;
+}
+
+static int valid_field(char *field) {
+    /*  Return whether an optional field of a submission would be accepted
+        by `create_pcb()`.
+     */
+    char *value = strchr(field, '=');
+    if (!value || !value[1]) {
+        return FALSE;
+    }
+    size_t len = value++ - field;
+    uint32_t number;
+    for (int i = 0; FIELDS[i]; i++) {
+        if (strlen(FIELDS[i]) != len || strncmp(field, FIELDS[i], len) != 0) {
+            continue;
+        }
+        if (strcmp(FIELDS[i], "tenant") == 0) {
+            return TRUE;
+        }
+        // a deadline may be 0, but weights and quanta must be positive
+        uint32_t min = strcmp(FIELDS[i], "deadline") == 0 ? 0 : 1;
+        return parse_number(value, min, INT32_MAX, &number);
+    }
+    return FALSE;
+}
+
+static void resume_clock(server_t *s, uint64_t now) {
+    /*  Advance simulation time over the cycles skipped while there were no
+        processes, so that a process submitted now arrives at the next
+        cycle.
+     */
+    cycle_t *c = s->c;
+    uint64_t period = DAEMON_CYCLE_MS * NS_PER_MS;
+    if (c->cycles == 0) {
+        s->next_cycle = now;
+        return;
+    }
+    uint64_t skipped = now > s->next_cycle
+                           ? (now - s->next_cycle) / period
+                           : 0;
+    c->simulation_time += (uint32_t)(skipped + 1) * c->quantum;
+    s->next_cycle += skipped * period;
+}
+
+static void submit(server_t *s, client_t *client, char *args) {
+    /*  Submit a process given as
+        <name> <service time> <memory size> [<key>=<value>]...
+     */
+    cycle_t *c = s->c;
+    char *tokens[DAEMON_LINE_LENGTH / 2];
+    int n = 0;
+    for (char *token = strtok(args, SEPARATOR); token;
+         token = strtok(NULL, SEPARATOR)) {
+        tokens[n++] = token;
+    }
+    uint32_t service, memory;
+    if (n < 3 || !parse_number(tokens[1], 1, INT32_MAX, &service) ||
+        !parse_number(tokens[2], 1, MAX_MEMORY, &memory)) {
+        reply(s, client, "ERROR usage SUBMIT <name> <service time> "
+                         "<memory size> [<key>=<value>]...");
+        return;
+    }
+    for (int i = 3; i < n; i++) {
+        if (!valid_field(tokens[i])) {
+            reply(s, client, "ERROR invalid field %s", tokens[i]);
+            return;
+        }
+    }
+    if (s->draining) {
+        reply(s, client, "ERROR shutting down");
+        return;
+    }
+    if (find_process(s, tokens[0])) {
+        reply(s, client, "ERROR duplicate name %s", tokens[0]);
+        return;
+    }
+
+    // the process arrives at the next cycle, which takes it from the
+    // arrivals queue in the order of submission
+    uint64_t now = wall_clock();
+    if (is_idle(s)) {
+        resume_clock(s, now);
+    }
+    char line[DAEMON_LINE_LENGTH + 16];
+    int len = snprintf(line, sizeof(line), "%" PRIu32, c->simulation_time);
+    for (int i = 0; i < n; i++) {
+        len += snprintf(line + len, sizeof(line) - len, " %s", tokens[i]);
+    }
+    pcb_t *pcb = create_pcb(line);
+    pcb->submitted_ns = now;
+    mpsc_push(c->arrivals, &pcb->arrival_node, pcb);
+    append(s->process_table, pcb);
+    rbtree_insert(s->names, pcb);
+    if (!s->submissions) {
+        s->first_submit = now;
+    }
+    s->last_submit = now;
+    s->submissions++;
+    reply(s, client, "OK %s %" PRIu32, pcb->name, pcb->arrival_time);
+}
+
+static int cancellable_ready(server_t *s, pcb_t *pcb) {
+    /*  Return whether a process can be removed from the ready queue. It
+        must not have started, and the scheduler must keep the ready
+        processes in the ready queue only.
+     */
+    char *scheduler = s->c->args->scheduler;
+    if (pcb->state != READY || s->c->args->aging ||
+        (strcmp(scheduler, SJF) != 0 && strcmp(scheduler, RR) != 0)) {
+        return FALSE;
+    }
+    return pcb->ready_node != NULL;
+}
+
+static void cancel(server_t *s, client_t *client, char *name) {
+    /*  Cancel a process that has not started, freeing any memory allocated
+        to it, and move it to the rejected queue.
+     */
+    cycle_t *c = s->c;
+    pcb_t *pcb = name ? find_process(s, name) : NULL;
+    if (!pcb) {
+        reply(s, client, "ERROR unknown process %s", name ? name : "");
+        return;
+    }
+    // a process submitted since the last cycle is still in the arrivals
+    // queue
+    drain_arrivals(c);
+    list_t *queue;
+    if (pcb->state == NEW) {
+        queue = pcb->process ? c->input_queue : c->submitted_queue;
+    } else if (cancellable_ready(s, pcb)) {
+        queue = c->ready_queue;
+        if (pcb->memory) {
+            trace_free(pcb->memory, c->simulation_time);
+            mm_free(c->memory, pcb->memory);
+            pcb->memory = NULL;
+        } else if (pcb->pages) {
+            pm_free_table(c->paged_memory, pcb->pages);
+            pcb->pages = NULL;
+        }
+    } else {
+        reply(s, client, "ERROR %s is %s", pcb->name, process_state(pcb));
+        return;
+    }
+    printf("%" PRIu32 ",CANCELLED,process_name=%s\n", c->simulation_time,
+           pcb->name);
+    if (queue == c->ready_queue) {
+        move_from_ready(c, pcb, c->rejected_queue);
+    } else {
+        move_data(pcb, queue, c->rejected_queue);
+    }
+    pcb->state = TERMINATED;
+    pcb->submitted_ns = 0;
+    s->cancellations++;
+    reply(s, client, "OK %s cancelled", pcb->name);
+}
+
+static void status(server_t *s, client_t *client, char *name) {
+    /*  Report the state, arrival time and remaining service time of a
+        process, and its termination time once finished.
+     */
+    pcb_t *pcb = name ? find_process(s, name) : NULL;
+    if (!pcb) {
+        reply(s, client, "ERROR unknown process %s", name ? name : "");
+        return;
+    }
+    const char *state = process_state(pcb);
+    if (strcmp(state, "finished") == 0) {
+        reply(s, client,
+              "OK %s %s arrival=%" PRIu32 " remaining=0 termination=%" PRIu32,
+              pcb->name, state, pcb->arrival_time, pcb->termination_time);
+    } else {
+        reply(s, client, "OK %s %s arrival=%" PRIu32 " remaining=%" PRIu32,
+              pcb->name, state, pcb->arrival_time, pcb->remaining_time);
+    }
+}
+
+static int cmp_latency(const void *a, const void *b) {
+    /*  Compare two latencies for sorting in ascending order.
+     */
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static void latency_percentiles(server_t *s, double *p50, double *p99,
+                                double *max) {
+    /*  Return the 50th and 99th percentiles and maximum of the scheduling
+        latency in milliseconds, by the nearest rank.
+     */
+    *p50 = *p99 = *max = 0;
+    int n = s->n_latencies;
+    if (!n) {
+        return;
+    }
+    qsort(s->latencies, n, sizeof(*s->latencies), cmp_latency);
+    *p50 = s->latencies[(n * 50 + 99) / 100 - 1];
+    *p99 = s->latencies[(n * 99 + 99) / 100 - 1];
+    *max = s->latencies[n - 1];
+}
+
+static void stats(server_t *s, client_t *client) {
+    /*  Report the simulation time, the number of processes submitted,
+        cancelled, finished, rejected and still queued, the connected
+        clients, the scheduling latency so far, and the depth of the
+        arrivals queue with the largest it has been.
+     */
+    cycle_t *c = s->c;
+    int done = list_len(c->finished_queue) + list_len(c->rejected_queue);
+    double p50, p99, max;
+    latency_percentiles(s, &p50, &p99, &max);
+    reply(s, client,
+          "OK time=%" PRIu32 " submitted=%d cancelled=%d finished=%d "
+          "rejected=%d queued=%d clients=%d latency=%.3f,%.3f,%.3f "
+          "arrivals=%d,%d",
+          c->simulation_time, s->submissions, s->cancellations,
+          list_len(c->finished_queue),
+          list_len(c->rejected_queue) - s->cancellations,
+          list_len(s->process_table) - done, s->n_clients, p50, p99, max,
+          mpsc_depth(c->arrivals), atomic_load(&c->arrivals->max_depth));
+}
+
+static void drain(server_t *s) {
+    /*  Stop accepting connections and submissions, and exit once every
+        process has finished.
+     */
+    s->draining = TRUE;
+    stop_listening(s);
+}
+
+static void handle_request(server_t *s, client_t *client, char *line) {
+    /*  Handle one request line of a client.
+     */
+    char *args = line + strcspn(line, SEPARATOR);
+    if (*args) {
+        *args++ = '\0';
+    }
+    if (strcmp(line, "SUBMIT") == 0) {
+        submit(s, client, args);
+        return;
+    }
+    char *name = strtok(args, SEPARATOR);
+    if (strcmp(line, "CANCEL") == 0) {
+        cancel(s, client, name);
+        return;
+    } else if (strcmp(line, "STATUS") == 0) {
+        status(s, client, name);
+        return;
+    } else if (strcmp(line, "STATS") == 0) {
+        stats(s, client);
+        return;
+    } else if (strcmp(line, "SHUTDOWN") == 0) {
+        drain(s);
+        reply(s, client, "OK draining %d",
+              list_len(s->process_table) - list_len(s->c->finished_queue) -
+                  list_len(s->c->rejected_queue));
+        return;
+    }
+    reply(s, client, "ERROR unknown request %s", line);
+}
+
+static void read_client(server_t *s, client_t *client) {
+    /*  Read what a client has sent and handle every complete line. The
+        client is disconnected once it closes its end, or if it sends a line
+        longer than DAEMON_LINE_LENGTH.
+     */
+    while (TRUE) {
+        ssize_t n = recv(client->fd, client->in + client->in_len,
+                         sizeof(client->in) - client->in_len, 0);
+        if (n == FAILED && errno == EINTR) {
+            continue;
+        }
+        if (n == FAILED && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return;
+        }
+        if (n <= 0) {
+            close_client(s, client);
+            return;
+        }
+        client->in_len += (size_t)n;
+
+        // handle every complete line, keeping the rest for the next read
+        char *start = client->in, *end;
+        char *last = client->in + client->in_len;
+        while ((end = memchr(start, '\n', last - start))) {
+            *end = '\0';
+            start[strcspn(start, "\r")] = '\0';
+            handle_request(s, client, start);
+            start = end + 1;
+        }
+        client->in_len -= start - client->in;
+        memmove(client->in, start, client->in_len);
+        if (client->in_len == sizeof(client->in)) {
+            reply(s, client, "ERROR request too long");
+            close_client(s, client);
+            return;
+        }
+    }
+}
+
+static void record_dispatch(server_t *s, uint64_t now) {
+    /*  Record the scheduling latency of the running process if it has just
+        run for the first time.
+     */
+    if (!s->c->running_queue->head) {
+        return;
+    }
+    pcb_t *pcb = (pcb_t *)s->c->running_queue->head->data;
+    if (!pcb->submitted_ns) {
+        return;
+    }
+    if (s->n_latencies == s->latencies_size) {
+        s->latencies_size = s->latencies_size ? s->latencies_size * 2 : 64;
+        s->latencies = (double *)realloc(
+            s->latencies, s->latencies_size * sizeof(*s->latencies));
+        assert(s->latencies);
+    }
+    s->latencies[s->n_latencies++] =
+        (double)(now - pcb->submitted_ns) / NS_PER_MS;
+    pcb->submitted_ns = 0;
+}
+
+static void daemon_cycle(server_t *s) {
+    /*  Run the cycle that is due, and schedule the next one.
+     */
+    cycle_t *c = s->c;
+    step_cycle(c);
+    record_dispatch(s, wall_clock());
+
+    // increment simulation time if there are processes left, otherwise the
+    // clock is resumed by the next submission
+    if (!is_idle(s)) {
+        c->simulation_time += c->quantum;
+    }
+    s->next_cycle += DAEMON_CYCLE_MS * NS_PER_MS;
+}
+
+static void handle_signal(server_t *s) {
+    /*  Shut down on SIGINT or SIGTERM.
+     */
+    struct signalfd_siginfo info;
+    while (read(s->signal_fd, &info, sizeof(info)) == sizeof(info)) {
+        drain(s);
+    }
+}
+
+static void print_daemon_statistics(server_t *s) {
+    /*  Print the number of processes submitted and cancelled with the rate
+        of submission per second of wall time, the number of clients
+        accepted, refused and connected at the same time, the 50th and
+        99th percentiles and maximum of the scheduling latency in
+        milliseconds, and the batches drained from the arrivals queue with
+        the largest batch and the largest depth of the queue.
+     */
+    mpsc_t *arrivals = s->c->arrivals;
+    double span = (double)(s->last_submit - s->first_submit) / 1e9;
+    double p50, p99, max;
+    latency_percentiles(s, &p50, &p99, &max);
+    printf("Submissions %d %d %.1f\n", s->submissions, s->cancellations,
+           span > 0 ? (s->submissions - 1) / span : 0);
+    printf("Clients %d %d %d\n", s->accepted, s->refused, s->peak_clients);
+    printf("Scheduling latency %.3f %.3f %.3f\n", p50, p99, max);
+    printf("Arrivals %" PRIu64 " %d %d\n", arrivals->batches,
+           arrivals->max_batch, atomic_load(&arrivals->max_depth));
+}
+
+static void free_server(server_t *s) {
+    /*  Disconnect every client and free the server and the simulation.
+     */
+    stop_listening(s);
+    while (s->clients->head) {
+        close_client(s, (client_t *)s->clients->head->data);
+    }
+    free_list(s->clients, NULL);
+    close(s->signal_fd);
+    close(s->epoll_fd);
+    free(s->latencies);
+    free_cycle(s->c);
+    free_rbtree(s->names, NULL);
+    free_list(s->process_table, free_pcb);
+    free(s);
+}
+
+void run_daemon(args_t *args) {
+    /*  Serve clients on the socket given by the `-D` flag, running a cycle
+        every DAEMON_CYCLE_MS milliseconds while there are processes, until
+        shut down once every process has finished.
+     */
+    server_t *s = create_server(args);
+    struct epoll_event events[DAEMON_EVENTS];
+    while (!s->draining || !is_idle(s)) {
+        // wait until the next cycle, or indefinitely without processes
+        int timeout = FAILED;
+        if (!is_idle(s)) {
+            uint64_t now = wall_clock();
+            timeout = now >= s->next_cycle
+                          ? 0
+                          : (int)((s->next_cycle - now + NS_PER_MS - 1) /
+                                  NS_PER_MS);
+        }
+        int n = epoll_wait(s->epoll_fd, events, DAEMON_EVENTS, timeout);
+        if (n == FAILED) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("epoll_wait");
+            exit(EXIT_FAILURE);
+        }
+        for (int i = 0; i < n; i++) {
+            void *ptr = events[i].data.ptr;
+            if (ptr == &s->listen_fd) {
+                accept_clients(s);
+            } else if (ptr == &s->signal_fd) {
+                handle_signal(s);
+            } else if (events[i].events & EPOLLOUT &&
+                       !(events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))) {
+                flush_client(s, (client_t *)ptr);
+            } else {
+                read_client(s, (client_t *)ptr);
+            }
+        }
+        if (!is_idle(s) && wall_clock() >= s->next_cycle) {
+            daemon_cycle(s);
+        }
+    }
+    print_statistics(s->c);
+    print_daemon_statistics(s);
+    free_server(s);
+}
@@ -0,0 +1,57 @@
+/* =============================================================================
+   daemon.h
+
+   Daemon mode of the process manager, which accepts submissions,
+   cancellations and status queries from local clients over a Unix domain
+   socket while the simulation runs.
+
+   Author: David Sha
+============================================================================= */
+#ifndef _DAEMON_H_
+#define _DAEMON_H_
+
+/* #includes ================================================================ */
+#include <stdint.h>
+#include "main.h"
+
+/* structures =============================================================== */
+typedef struct client {
+    int fd;
+    node_t *node;
+    char in[DAEMON_LINE_LENGTH];
+    size_t in_len;
+    char *out;
+    size_t out_len;
+    size_t out_size;
+    int writing;
+} client_t;
+
+typedef struct server {
+    cycle_t *c;
+    list_t *process_table;
+    rbtree_t *names;
+    int listen_fd;
+    int signal_fd;
+    int epoll_fd;
+    list_t *clients;
+    int n_clients;
+    int max_clients;
+    int peak_clients;
+    int accepted;
+    int refused;
+    int submissions;
+    int cancellations;
+    int draining;
+    uint64_t first_submit;
+    uint64_t last_submit;
+    uint64_t next_cycle;
+    double *latencies;
+    int n_latencies;
+    int latencies_size;
+} server_t;
+
+/* function prototypes ====================================================== */
+void raise_fd_limit();
+void run_daemon(args_t *args);
+
+#endif
@@ -0,0 +1,71 @@
+/* =============================================================================
+   emulator.c
+
+   The implementation of the emulated backend. Each process keeps the same
+   128 byte buffer as the process executable. The process name and every
+   5 byte record, i.e. the operation followed by the 4 byte big endian
+   simulation time, are XOR-folded into the buffer in exactly the same way
+   as `store()` in process.c, and the first 119 bytes are hashed when the
+   process terminates. The resulting SHA is identical to the one printed
+   by a real process, but no system calls are made.
+
+   Author: David Sha
+============================================================================= */
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "config.h"
+#include "emulator.h"
+#include "sha256.h"
+
+static void store(process_t *process, uint8_t *buf, size_t len) {
+    /*  XOR-fold `len` bytes into the buffer of a process. The index is
+        advanced in the same (unusual) way as `store()` in process.c.
+     */
+    for (size_t i = 0; i < len; i++) {
+        process->content_index =
+            (process->content_index + i) % SHA_CONTENT_LENGTH;
+        process->content[process->content_index] ^= buf[i];
+    }
+}
+
+void emulate_start(process_t *process) {
+    /*  Create the buffer of a process and fold in its name, as the
+        process executable does when it is executed.
+     */
+    if (process->content) {
+        return;
+    }
+    process->content = (uint8_t *)calloc(SHA_BUFFER_LENGTH, sizeof(uint8_t));
+    assert(process->content);
+    process->content_index = 0;
+    store(process, (uint8_t *)process->name, strlen(process->name));
+}
+
+void emulate_message(process_t *process, op_t op, char *simulation_time) {
+    /*  Fold the record of a message into the buffer of a process.
+     */
+    uint8_t buf[BIG_ENDIAN_BYTES + 1];
+    buf[0] = (uint8_t)op;
+    memcpy(buf + 1, simulation_time, BIG_ENDIAN_BYTES);
+    store(process, buf, BIG_ENDIAN_BYTES + 1);
+}
+
+char *emulate_terminate(process_t *process, char *simulation_time) {
+    /*  Fold the termination record into the buffer of a process and
+        return the SHA of the buffer as a string.
+     */
+    emulate_message(process, TERM, simulation_time);
+    char *string = (char *)calloc(SHA256_LENGTH + 1, sizeof(char));
+    assert(string);
+    sha256_hash(string, process->content, SHA_CONTENT_LENGTH);
+    emulate_free(process);
+    return string;
+}
+
+void emulate_free(process_t *process) {
+    /*  Free the buffer of a process.
+     */
+    free(process->content);
+    process->content = NULL;
+}
@@ -0,0 +1,22 @@
+/* =============================================================================
+   emulator.h
+
+   Emulation of the process executable inside the manager, so that the
+   FINISHED-PROCESS SHA of each process can be produced without forking
+   real processes.
+
+   Author: David Sha
+============================================================================= */
+#ifndef _EMULATOR_H_
+#define _EMULATOR_H_
+
+/* #includes ================================================================ */
+#include "process-api.h"
+
+/* function prototypes ====================================================== */
+void emulate_start(process_t *process);
+void emulate_message(process_t *process, op_t op, char *simulation_time);
+char *emulate_terminate(process_t *process, char *simulation_time);
+void emulate_free(process_t *process);
+
+#endif
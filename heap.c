@@ -0,0 +1,109 @@
+/* =============================================================================
+   heap.c
+
+   Binary min-heap that allows any data type to be stored, ordered by a
+   given comparison function. The smallest element is at the root, and
+   pushing or popping an element takes O(log n) time.
+
+   Author: David Sha
+============================================================================= */
+#include <assert.h>
+#include <stdlib.h>
+#include "heap.h"
+
+#define INITIAL_HEAP_SIZE 16
+
+heap_t *create_heap(int (*cmp)(void *, void *)) {
+    /*  Create an empty heap ordered by `cmp`, which returns a negative
+        number if the first element should be popped before the second.
+     */
+    heap_t *heap;
+    heap = (heap_t *)malloc(sizeof(*heap));
+    assert(heap);
+    heap->data = (void **)malloc(INITIAL_HEAP_SIZE * sizeof(void *));
+    assert(heap->data);
+    heap->len = 0;
+    heap->size = INITIAL_HEAP_SIZE;
+    heap->cmp = cmp;
+    return heap;
+}
+
+void free_heap(heap_t *heap, void (*free_data)(void *data)) {
+    /*  Free the heap. Give a function pointer to free the data. If no
+        function pointer is given, the data will not be freed.
+     */
+    assert(heap);
+    if (free_data) {
+        for (int i = 0; i < heap->len; i++) {
+            free_data(heap->data[i]);
+        }
+    }
+    free(heap->data);
+    free(heap);
+}
+
+int heap_len(heap_t *heap) {
+    /*  Return the number of elements in the heap.
+     */
+    assert(heap);
+    return heap->len;
+}
+
+static void swap(heap_t *heap, int i, int j) {
+    /*  Swap two elements of the heap.
+     */
+    void *temp = heap->data[i];
+    heap->data[i] = heap->data[j];
+    heap->data[j] = temp;
+}
+
+void heap_push(heap_t *heap, void *data) {
+    /*  Add an element to the heap and sift it up to its place.
+     */
+    assert(heap);
+    if (heap->len == heap->size) {
+        heap->size *= 2;
+        heap->data = (void **)realloc(heap->data, heap->size * sizeof(void *));
+        assert(heap->data);
+    }
+    int i = heap->len++;
+    heap->data[i] = data;
+    while (i > 0 && heap->cmp(heap->data[i], heap->data[(i - 1) / 2]) < 0) {
+        swap(heap, i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+}
+
+void *heap_peek(heap_t *heap) {
+    /*  Return the smallest element without removing it, or NULL if the
+        heap is empty.
+     */
+    assert(heap);
+    return heap->len ? heap->data[0] : NULL;
+}
+
+void *heap_pop(heap_t *heap) {
+    /*  Remove and return the smallest element, or NULL if the heap is
+        empty. The last element is moved to the root and sifted down.
+     */
+    assert(heap);
+    if (heap->len == 0) {
+        return NULL;
+    }
+    void *min = heap->data[0];
+    heap->data[0] = heap->data[--heap->len];
+    int i = 0;
+    while (2 * i + 1 < heap->len) {
+        int child = 2 * i + 1;
+        if (child + 1 < heap->len &&
+            heap->cmp(heap->data[child + 1], heap->data[child]) < 0) {
+            child++;
+        }
+        if (heap->cmp(heap->data[child], heap->data[i]) >= 0) {
+            break;
+        }
+        swap(heap, i, child);
+        i = child;
+    }
+    return min;
+}
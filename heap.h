@@ -0,0 +1,28 @@
+/* =============================================================================
+   heap.h
+
+   Binary min-heap that allows any data type to be stored, ordered by a
+   given comparison function.
+
+   Author: David Sha
+============================================================================= */
+#ifndef _HEAP_H_
+#define _HEAP_H_
+
+/* structures =============================================================== */
+typedef struct heap {
+    void **data;
+    int len;
+    int size;
+    int (*cmp)(void *, void *);
+} heap_t;
+
+/* function prototypes ====================================================== */
+heap_t *create_heap(int (*cmp)(void *, void *));
+void free_heap(heap_t *heap, void (*free_data)(void *data));
+int heap_len(heap_t *heap);
+void heap_push(heap_t *heap, void *data);
+void *heap_peek(heap_t *heap);
+void *heap_pop(heap_t *heap);
+
+#endif
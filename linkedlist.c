@@ -16,6 +16,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include "linkedlist.h"
+#include "profile.h"
 
 list_t *create_empty_list() {
     /*  Creates an empty linked list.
@@ -24,6 +25,7 @@ list_t *create_empty_list() {
     list = (list_t *)malloc(sizeof(*list));
     assert(list);
     list->head = list->foot = NULL;
+    list->len = 0;
     return list;
 }
 
@@ -34,6 +36,9 @@ list_t *create_list(node_t *head, node_t *foot) {
     list_t *new = create_empty_list();
     new->head = head;
     new->foot = foot;
+    for (node_t *curr = head; curr; curr = curr->next) {
+        new->len++;
+    }
     return new;
 }
 
@@ -80,6 +85,7 @@ list_t *prepend(list_t *list, void *data) {
         list->foot = new;
     }
     list->head = new;
+    list->len++;
     return list;
 }
 
@@ -100,21 +106,15 @@ list_t *append(list_t *list, void *data) {
         list->head = new;
     }
     list->foot = new;
+    list->len++;
     return list;
 }
 
 int list_len(list_t *list) {
-    /*  Get the linked list length.
+    /*  Get the linked list length, which is kept as the list changes.
      */
     assert(list);
-    int len = 0;
-    node_t *curr;
-    curr = list->head;
-    while (curr) {
-        len++;
-        curr = curr->next;
-    }
-    return len;
+    return list->len;
 }
 
 void remove_node(list_t *list, node_t *node) {
@@ -142,6 +142,7 @@ void remove_node(list_t *list, node_t *node) {
             node->next->prev = node->prev;
         }
     }
+    list->len--;
     free(node);
 }
 
@@ -152,6 +153,7 @@ void *remove_data(list_t *list, void *data) {
     node_t *curr;
     curr = list->head;
     while (curr) {
+        profile.list_visits++;
         if (curr->data == data) {
             remove_node(list, curr);
             return data;
@@ -187,6 +189,7 @@ void *pop(list_t *list) {
             list->head->prev = NULL;
         }
         void *data = head->data;
+        list->len--;
         free(head);
         return data;
     }
@@ -224,6 +227,7 @@ list_t *insert_prev(list_t *list, node_t *node, void *data) {
         list->head = new;
     }
     node->prev = new;
+    list->len++;
     return list;
 }
 
@@ -244,6 +248,7 @@ list_t *insert_next(list_t *list, node_t *node, void *data) {
         list->foot = new;
     }
     node->next = new;
+    list->len++;
     return list;
 }
 
@@ -252,6 +257,7 @@ void *find_node(list_t *list, void *data, int (*cmp)(void *, void *)) {
      */
     assert(list && data && cmp);
     for (node_t *curr = list->head; curr; curr = curr->next) {
+        profile.list_visits++;
         if (cmp(curr->data, data) == 0) {
             return curr;
         }
@@ -272,5 +278,6 @@ void copy_list(list_t *from, list_t *to) {
     for (node_t *curr = from->head; curr; curr = curr->next) {
         void *data = curr->data;
         append(to, data);
+        profile.list_visits++;
     }
 }
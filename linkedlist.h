@@ -23,6 +23,7 @@ struct node {
 typedef struct list {
     node_t *head;
     node_t *foot;
+    int len;
 } list_t;
 
 /* function prototypes ====================================================== */
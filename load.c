@@ -0,0 +1,258 @@
+/* =============================================================================
+   load.c
+
+   Load generator for the daemon started with the `-D` flag of `allocate`.
+   Connects the given number of clients to the daemon's socket, then every
+   client submits its processes one at a time, sending the next once the
+   previous one is acknowledged. All clients are driven by a single epoll
+   instance.
+
+   Usage: ./load [-s] <socket> [clients] [jobs] [service time] [memory size]
+
+   Prints the number of clients, the submissions acknowledged and refused
+   with the time they took, the throughput in submissions per second, and
+   the 50th and 99th percentiles and maximum of the time to acknowledge a
+   submission in milliseconds. Then prints the reply of the daemon to STATS
+   and, with `-s`, shuts the daemon down.
+
+   Author: David Sha
+============================================================================= */
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#define FAILED -1
+#define TRUE 1
+#define FALSE 0
+#define LINE_LENGTH 256
+#define EVENTS 256
+
+typedef struct client {
+    int fd;
+    int sent;
+    int acked;
+    double since;
+    char in[LINE_LENGTH];
+    size_t in_len;
+} client_t;
+
+static char *path;
+static int jobs = 10, service = 1, memory = 1;
+static double *latencies;
+static int n_latencies = 0, refused = 0;
+
+static double now() {
+    /*  Return the monotonic wall time in seconds.
+     */
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int connect_daemon() {
+    /*  Connect to the daemon, blocking until it accepts.
+     */
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd == FAILED) {
+        perror("socket");
+        exit(EXIT_FAILURE);
+    }
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == FAILED) {
+        perror(path);
+        exit(EXIT_FAILURE);
+    }
+    return fd;
+}
+
+static void send_line(int fd, const char *line) {
+    /*  Send a request. Requests are short and at most one is outstanding
+        per client, so they always fit in the socket buffer.
+     */
+    size_t len = strlen(line);
+    if (send(fd, line, len, MSG_NOSIGNAL) != (ssize_t)len) {
+        perror("send");
+        exit(EXIT_FAILURE);
+    }
+}
+
+static void submit(client_t *client, int id) {
+    /*  Submit the next process of a client.
+     */
+    char line[LINE_LENGTH];
+    snprintf(line, sizeof(line), "SUBMIT load%d-%d-%d %d %d\n", (int)getpid(),
+             id, client->sent, service, memory);
+    client->since = now();
+    send_line(client->fd, line);
+    client->sent++;
+}
+
+static int read_replies(client_t *client, int id) {
+    /*  Read the replies of the daemon to a client, submitting the next
+        process after each one. Return FALSE once the client is done.
+     */
+    while (TRUE) {
+        ssize_t n = recv(client->fd, client->in + client->in_len,
+                         sizeof(client->in) - client->in_len, 0);
+        if (n == FAILED && errno == EINTR) {
+            continue;
+        }
+        if (n == FAILED && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return TRUE;
+        }
+        if (n <= 0) {
+            // the daemon closed the connection, refusing the rest
+            refused += jobs - client->acked;
+            return FALSE;
+        }
+        client->in_len += (size_t)n;
+        char *start = client->in, *end;
+        char *last = client->in + client->in_len;
+        while ((end = memchr(start, '\n', last - start))) {
+            if (strncmp(start, "OK", 2) == 0) {
+                latencies[n_latencies++] = (now() - client->since) * 1e3;
+            } else {
+                refused++;
+            }
+            client->acked++;
+            start = end + 1;
+            if (client->acked == jobs) {
+                return FALSE;
+            }
+            submit(client, id);
+        }
+        client->in_len -= start - client->in;
+        memmove(client->in, start, client->in_len);
+    }
+}
+
+static int cmp_double(const void *a, const void *b) {
+    /*  Compare two doubles for sorting in ascending order.
+     */
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static void request(const char *line) {
+    /*  Send a request on a new connection and print its reply.
+     */
+    int fd = connect_daemon();
+    send_line(fd, line);
+    char reply[LINE_LENGTH];
+    ssize_t len = 0, n;
+    while (len < (ssize_t)sizeof(reply) - 1 &&
+           (n = recv(fd, reply + len, sizeof(reply) - 1 - len, 0)) > 0) {
+        len += n;
+        if (reply[len - 1] == '\n') {
+            break;
+        }
+    }
+    reply[len] = '\0';
+    printf("Daemon %s", reply);
+    close(fd);
+}
+
+int main(int argc, char *argv[]) {
+    int stop = argc > 1 && strcmp(argv[1], "-s") == 0;
+    argv += stop;
+    argc -= stop;
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s [-s] <socket> [clients] [jobs] "
+                        "[service time] [memory size]\n",
+                argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    path = argv[1];
+    int n_clients = argc > 2 ? atoi(argv[2]) : 100;
+    jobs = argc > 3 ? atoi(argv[3]) : jobs;
+    service = argc > 4 ? atoi(argv[4]) : service;
+    memory = argc > 5 ? atoi(argv[5]) : memory;
+    if (n_clients <= 0 || jobs <= 0 || service <= 0 || memory <= 0) {
+        fprintf(stderr, "Error: Arguments must be positive integers\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // every client needs a file descriptor
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    int epoll_fd = epoll_create1(0);
+    if (epoll_fd == FAILED) {
+        perror("epoll_create1");
+        exit(EXIT_FAILURE);
+    }
+    client_t *clients = (client_t *)calloc(n_clients, sizeof(*clients));
+    assert(clients);
+    latencies = (double *)malloc((size_t)n_clients * jobs * sizeof(double));
+    assert(latencies);
+    for (int i = 0; i < n_clients; i++) {
+        clients[i].fd = connect_daemon();
+        fcntl(clients[i].fd, F_SETFL, O_NONBLOCK);
+        struct epoll_event event = {.events = EPOLLIN, .data.u32 = i};
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, clients[i].fd, &event) ==
+            FAILED) {
+            perror("epoll_ctl");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // every client submits its first process at once, then the next one
+    // as each is acknowledged
+    double start = now();
+    for (int i = 0; i < n_clients; i++) {
+        submit(&clients[i], i);
+    }
+    int active = n_clients;
+    struct epoll_event events[EVENTS];
+    while (active) {
+        int n = epoll_wait(epoll_fd, events, EVENTS, FAILED);
+        if (n == FAILED) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("epoll_wait");
+            exit(EXIT_FAILURE);
+        }
+        for (int i = 0; i < n; i++) {
+            int id = events[i].data.u32;
+            if (!read_replies(&clients[id], id)) {
+                close(clients[id].fd);
+                active--;
+            }
+        }
+    }
+    double elapsed = now() - start;
+
+    qsort(latencies, n_latencies, sizeof(double), cmp_double);
+    printf("Clients %d\n", n_clients);
+    printf("Submissions %d %d %.3f\n", n_latencies, refused, elapsed);
+    printf("Throughput %.1f\n", elapsed > 0 ? n_latencies / elapsed : 0);
+    if (n_latencies) {
+        printf("Ack latency %.3f %.3f %.3f\n",
+               latencies[(n_latencies * 50 + 99) / 100 - 1],
+               latencies[(n_latencies * 99 + 99) / 100 - 1],
+               latencies[n_latencies - 1]);
+    }
+    request("STATS\n");
+    if (stop) {
+        request("SHUTDOWN\n");
+    }
+
+    free(latencies);
+    free(clients);
+    close(epoll_fd);
+    return EXIT_SUCCESS;
+}
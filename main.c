@@ -7,17 +7,35 @@
    Author: David Sha
 ============================================================================= */
 #include <assert.h>
+#include <time.h>
 #include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <arpa/inet.h>
 #include "main.h"
+#include "checkpoint.h"
+#include "scheduler.h"
+#include "profile.h"
+#include "trace.h"
+#include "series.h"
+#include "daemon.h"
+#include "realtime.h"
+#include "placement.h"
 
 // possible arguments
-const char *const SCHEDULERS[] = {SJF, RR, NULL};
-const char *const MEMORY_METHODS[] = {INFINITE, BESTFIT, NULL};
-const char *const QUANTUMS[] = {"1", "2", "3", NULL};
+const char *const SCHEDULERS[] = {SJF, RR, MLFQ, SRTF, CFS, EDF, SJF_EST, NULL};
+const char *const MEMORY_METHODS[] = {INFINITE, BESTFIT, PAGED, NULL};
+const char *const BACKENDS[] = {BLOCKING, URING, EMULATED, NULL};
+const char *const ADMISSIONS[] = {FIFO, RESERVE, SMALLEST, LARGEST, NULL};
+const char *const REPLACEMENTS[] = {LRU, CLOCK, TWO_Q, NULL};
+const char *const PLACEMENTS[] = {FLOAT, SPREAD, PACK, NULL};
+
+// columns of the memory time series
+const char *const MEMORY_COLUMNS[] = {
+    "time",          "free_bytes",  "largest_free", "free_fragments",
+    "fragmentation", "utilisation", "input_queue",  "fragmented",
+    NULL};
 
 int main(int argc, char *argv[]) {
     /*  Main function. Parse arguments and run simulation.
@@ -25,13 +43,111 @@ int main(int argc, char *argv[]) {
 
     // read in flags and arguments
     args_t *args = parse_args(argc, argv);
-    assert(args->file != NULL);
+    assert(args->file != NULL || args->daemon != NULL);
     assert(args->scheduler != NULL);
     assert(args->memory != NULL);
     assert(args->quantum != NULL);
+    if (strcmp(args->quantum, ADAPTIVE) != 0 && atoi(args->quantum) <= 0) {
+        printf("Invalid argument for flag -q. Must be a positive integer or "
+               "%s\n",
+               ADAPTIVE);
+        exit(EXIT_FAILURE);
+    }
+
+    // the daemon takes processes from its socket only, and cannot be
+    // snapshotted since its clients cannot be
+    if (args->daemon && (args->file || args->checkpoint || args->restore)) {
+        printf("Invalid flag -D. Cannot be used with -f, -c or -r\n");
+        exit(EXIT_FAILURE);
+    }
+    if (args->daemon) {
+        raise_fd_limit();
+    }
 
-    // run simulation via the process manager
-    process_manager(args);
+    // pace cycles by the wall clock, so that real processes use the CPU
+    // for as long as they are scheduled. The daemon is paced by its own
+    // cycle timer instead
+    if (args->realtime) {
+        if (args->daemon) {
+            printf("Invalid flag -R. Cannot be used with -D\n");
+            exit(EXIT_FAILURE);
+        }
+        if (atoi(args->realtime) <= 0) {
+            printf("Invalid argument for flag -R. Must be a positive "
+                   "integer\n");
+            exit(EXIT_FAILURE);
+        }
+        open_realtime((uint32_t)atoi(args->realtime));
+        spin_processes();
+    }
+
+    // limit the number of real processes alive at the same time
+    int max_live = args->live ? atoi(args->live) : MAX_LIVE_PROCESSES;
+    if (max_live <= 0) {
+        printf("Invalid argument for flag -l. Must be a positive integer\n");
+        exit(EXIT_FAILURE);
+    }
+    configure_processes(max_live, args->backend);
+    if (args->cgroup) {
+        control_processes(args->cgroup);
+    }
+    if (args->placement) {
+        place_processes(args->placement);
+    }
+    if (args->usage) {
+        time_processes();
+    }
+    if (args->profile) {
+        enable_profile();
+    }
+    if (args->trace) {
+        open_trace(args->trace);
+    }
+
+    // swapping moves processes out of the ready queue, which only SJF and
+    // RR keep without a structure of their own
+    if (args->swap && (strcmp(args->memory, BESTFIT) != 0 || args->aging ||
+                       (strcmp(args->scheduler, SJF) != 0 &&
+                        strcmp(args->scheduler, RR) != 0))) {
+        printf("Invalid flag -S. Requires -m %s and -s %s or %s without "
+               "-a\n",
+               BESTFIT, SJF, RR);
+        exit(EXIT_FAILURE);
+    }
+
+    // snapshot every `interval` cycles
+    if (args->interval && atoi(args->interval) <= 0) {
+        printf("Invalid argument for flag -k. Must be a positive integer\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // boost MLFQ every `period` seconds, or never if 0
+    if (args->boost) {
+        char *end;
+        long period = strtol(args->boost, &end, 10);
+        if (end == args->boost || *end != '\0' || period < 0 ||
+            period > UINT32_MAX) {
+            printf("Invalid argument for flag -B. Must be a non-negative "
+                   "integer\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // bound the length of the input queue
+    if (args->input_bound && atoi(args->input_bound) <= 0) {
+        printf("Invalid argument for flag -Q. Must be a positive integer\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // run simulation via the process manager, or serve clients until shut
+    // down
+    if (args->daemon) {
+        run_daemon(args);
+    } else {
+        process_manager(args);
+    }
+    close_realtime();
+    free_processes();
     free(args);
 
     return EXIT_SUCCESS;
@@ -51,49 +167,67 @@ void process_manager(args_t *args) {
     }
 
     // read in file
-    FILE *fp = fopen(args->file, "r");
+    list_t *submitted_pcbs = read_pcbs(args->file);
+    if (DEBUG) {
+        printf("ACTION: Printing submitted queue...\n");
+        print_list(submitted_pcbs, print_pcb);
+    }
+
+    // run simulation given the processes in the submitted queue and the args
+    run_cycles(submitted_pcbs, args);
+    free_list(submitted_pcbs, free_pcb);
+}
+
+list_t *read_pcbs(char *file) {
+    /*  Read the processes of an input file into a new list of PCBs, in the
+        order they appear in the file.
+     */
+    FILE *fp = fopen(file, "r");
     assert(fp);
 
     // for each line in the file, parse it and add it to a linked list
-    list_t *submitted_pcbs = create_empty_list();
+    list_t *pcbs = create_empty_list();
     char *line = NULL;
     size_t len = 0;
     ssize_t read;
     pcb_t *pcb;
     while ((read = getline(&line, &len, fp)) != FAILED) {
         pcb = create_pcb(line);
-        append(submitted_pcbs, pcb);
+        append(pcbs, pcb);
     }
     if (line) {
         free(line);
     }
     fclose(fp);
-    if (DEBUG) {
-        printf("ACTION: Printing submitted queue...\n");
-        print_list(submitted_pcbs, print_pcb);
-    }
-
-    // run simulation given the processes in the submitted queue and the args
-    run_cycles(submitted_pcbs, args);
-    free_list(submitted_pcbs, free_pcb);
+    return pcbs;
 }
 
 void run_cycles(list_t *process_table, args_t *args) {
     /*  This function runs the simulation for the given list of submitted
-        processes and the given arguments.
+        processes and the given arguments, resuming from a snapshot if one
+        is given.
     */
-    int total_processes = list_len(process_table);
     cycle_t *c = create_cycle(args);
-
-    // copy processes from process table to submitted queue
-    copy_list(process_table, c->submitted_queue);
+    if (args->restore) {
+        // the process table then also owns the restored processes
+        restore_checkpoint(c, args->restore, process_table);
+        restore_scheduler(c);
+    } else {
+        // copy processes from process table to submitted queue
+        copy_list(process_table, c->submitted_queue);
+    }
+    int total_processes = list_len(process_table);
+    uint32_t interval =
+        args->interval ? (uint32_t)atoi(args->interval) : CHECKPOINT_INTERVAL;
 
     // on each cycle
-    while (list_len(c->finished_queue) < total_processes) {
+    start_realtime(c->simulation_time);
+    while (list_len(c->finished_queue) + list_len(c->rejected_queue) <
+           total_processes) {
         if (DEBUG) {
             printf("%" PRIu32 "\n", c->simulation_time);
             printf("   memory: ");
-            print_list(c->memory, print_block);
+            print_list(c->memory->blocks, print_block);
             printf("submitted: ");
             print_list(c->submitted_queue, print_pcb);
             printf("    input: ");
@@ -105,44 +239,188 @@ void run_cycles(list_t *process_table, args_t *args) {
             printf(" finished: ");
             print_list(c->finished_queue, print_pcb);
         }
-        run_cycle(c);
+        step_cycle(c);
 
         // increment simulation time if not finished with all processes
-        if (list_len(c->finished_queue) < total_processes) {
+        if (list_len(c->finished_queue) + list_len(c->rejected_queue) <
+            total_processes) {
             c->simulation_time += c->quantum;
+
+            // snapshot the simulation between cycles, after flushing the
+            // transcript so far
+            if (args->checkpoint && c->cycles % interval == 0) {
+                uint64_t save = profile_start();
+                fflush(stdout);
+                save_checkpoint(c, args->checkpoint);
+                profile_end(PHASE_CHECKPOINT, save);
+            }
+
+            // let the running process use the wall time of the quantum
+            wait_realtime(c->simulation_time);
         }
     }
-    print_performance_statistics(c);
+    print_statistics(c);
     free_cycle(c);
 }
 
+void step_cycle(cycle_t *c) {
+    /*  Run a single cycle and record it: its wall time, the trace and the
+        memory series, then collect real processes that have exited.
+     */
+    struct timespec start, end;
+
+    // sample where the process that ran through the last quantum ran
+    if (c->args->placement && c->running_queue->head) {
+        pcb_t *pcb = (pcb_t *)c->running_queue->head->data;
+        sample_process(pcb->process);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    run_cycle(c);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    trace_cycle(c);
+    if (c->memory_series) {
+        sample_memory(c);
+    }
+    double latency = (end.tv_sec - start.tv_sec) * 1e6 +
+                     (end.tv_nsec - start.tv_nsec) / 1e3;
+    c->cycles++;
+    c->total_latency += latency;
+    if (latency > c->max_latency) {
+        c->max_latency = latency;
+    }
+
+    // collect real processes that have exited since the last cycle, and
+    // move the output of commands to their logs
+    uint64_t reap = profile_start();
+    reap_processes(FALSE);
+    drain_processes();
+    profile_end(PHASE_REAP, reap);
+}
+
+void print_statistics(cycle_t *c) {
+    /*  Print the statistics at the end of the simulation, and write the
+        files of the options that collect them.
+     */
+    args_t *args = c->args;
+    print_performance_statistics(c);
+    close_trace(c);
+
+    // task4: wait for all real processes to exit before reporting their
+    // resource usage
+    reap_processes(TRUE);
+    print_scheduler_statistics(c);
+    if (c->paged_memory) {
+        print_paging_statistics(c);
+    }
+    if (args->swap) {
+        print_swap_statistics(c);
+    }
+    if (args->admission || args->input_bound) {
+        print_admission_statistics(c);
+    }
+    if (args->usage) {
+        print_usage_statistics(c);
+    }
+    if (is_realtime()) {
+        print_realtime_statistics();
+    }
+    if (args->placement) {
+        print_placement_statistics(c);
+    }
+    if (args->profile) {
+        dump_profile(args->profile, c->cycles, count_syscalls());
+    }
+    if (c->memory_series) {
+        FILE *fp = fopen(args->memory_series, "w");
+        if (!fp) {
+            perror(args->memory_series);
+            exit(EXIT_FAILURE);
+        }
+        write_series(c->memory_series, fp);
+        fclose(fp);
+    }
+}
+
+void move_to_ready(cycle_t *c, pcb_t *pcb, list_t *from) {
+    /*  Move a process from another queue to the end of the ready queue,
+        keeping its node so that it leaves the ready queue in O(1) time.
+     */
+    move_data(pcb, from, c->ready_queue);
+    pcb->ready_node = c->ready_queue->foot;
+}
+
+void move_from_ready(cycle_t *c, pcb_t *pcb, list_t *to) {
+    /*  Move a process from the ready queue to the end of another queue,
+        without searching the ready queue for it.
+     */
+    assert(pcb->ready_node);
+    remove_node(c->ready_queue, pcb->ready_node);
+    pcb->ready_node = NULL;
+    append(to, pcb);
+}
+
 void run_cycle(cycle_t *c) {
     /*  This function runs a single cycle of the simulation.
      */
 
     // if current running process has completed, terminate it and
     // deallocate its memory
+    uint64_t start = profile_start();
     manage_termination(c);
+    profile_end(PHASE_TERMINATION, start);
 
     // identify all processes that have been submitted since the last cycle
     // occurred and add them to the input queue in the order they appear
     // in the process file
+    start = profile_start();
     manage_arrival(c);
+    c->arrived_until = c->simulation_time;
+    profile_end(PHASE_ARRIVAL, start);
 
     // move processes from the input queue to the ready queue upon
     // successful memory allocation
+    start = profile_start();
     if (strcmp(c->args->memory, INFINITE) == 0) {
         infinite(c);
     } else if (strcmp(c->args->memory, BESTFIT) == 0) {
         bestfit(c);
+    } else if (strcmp(c->args->memory, PAGED) == 0) {
+        paged(c);
     }
+    profile_end(PHASE_MEMORY, start);
 
     // determine the process that will run in this cycle
+    start = profile_start();
     if (strcmp(c->args->scheduler, SJF) == 0) {
-        sjf(c);
+        if (c->args->aging) {
+            sjf_aging(c);
+        } else {
+            sjf(c);
+        }
     } else if (strcmp(c->args->scheduler, RR) == 0) {
         rr(c);
+    } else if (strcmp(c->args->scheduler, MLFQ) == 0) {
+        mlfq(c);
+    } else if (strcmp(c->args->scheduler, SRTF) == 0) {
+        srtf(c);
+    } else if (strcmp(c->args->scheduler, CFS) == 0) {
+        cfs(c);
+    } else if (strcmp(c->args->scheduler, EDF) == 0) {
+        edf(c);
+    } else if (strcmp(c->args->scheduler, SJF_EST) == 0) {
+        sjf_est(c);
     }
+    profile_end(PHASE_SCHEDULE, start);
+
+    // choose the length of this cycle
+    start = profile_start();
+    end_cycle(c);
+    profile_end(PHASE_END_CYCLE, start);
+
+    // task4: submit the messages sent to real processes in this cycle
+    start = profile_start();
+    flush_processes();
+    profile_end(PHASE_FLUSH, start);
 }
 
 void manage_termination(cycle_t *c) {
@@ -161,12 +439,18 @@ void manage_termination(cycle_t *c) {
     // should be terminated
     pcb_t *pcb = (pcb_t *)curr->data;
 
-    // decrement remaining time by the quantum. if remaining time
-    // becomes negative, set it to 0
-    if (pcb->remaining_time < c->quantum) {
+    // decrement remaining time by the quantum, less the time stalled on
+    // page faults. if remaining time becomes negative, set it to 0
+    uint32_t progress = c->quantum;
+    if (c->paged_memory) {
+        uint32_t seconds =
+            pcb->remaining_time < c->quantum ? pcb->remaining_time : c->quantum;
+        progress -= reference_pages(c, pcb, seconds);
+    }
+    if (pcb->remaining_time < progress) {
         pcb->remaining_time = 0;
     } else {
-        pcb->remaining_time -= c->quantum;
+        pcb->remaining_time -= progress;
     }
 
     // if remaining time is not 0, do not terminate
@@ -181,17 +465,23 @@ void manage_termination(cycle_t *c) {
 
     // deallocate memory if using best-fit
     if (strcmp(c->args->memory, BESTFIT) == 0) {
+        trace_free(pcb->memory, c->simulation_time);
         mm_free(c->memory, pcb->memory);
         pcb->memory = NULL;
+    } else if (pcb->pages) {
+        pm_free_table(c->paged_memory, pcb->pages);
+        pcb->pages = NULL;
     }
 
     printf("%" PRIu32 ",FINISHED,process_name=%s,proc_remaining=%d\n",
            c->simulation_time, pcb->name,
-           list_len(c->input_queue) + list_len(c->ready_queue));
+           list_len(c->input_queue) + list_len(c->ready_queue) +
+               list_len(c->swapped_queue));
 
     // update the process manager's data structures
     move_data(pcb, c->running_queue, c->finished_queue);
     pcb->state = TERMINATED;
+    finish_scheduled(c, pcb);
     pcb->termination_time = c->simulation_time;
 
     // task4: terminate process
@@ -209,6 +499,7 @@ void manage_arrival(cycle_t *c) {
         to the system if its arrival time is less than or equal to the
         current simulation time.
      */
+    drain_arrivals(c);
     while (TRUE) {
         node_t *curr = c->submitted_queue->head;
 
@@ -221,14 +512,42 @@ void manage_arrival(cycle_t *c) {
         // should be added to the input queue
         pcb_t *pcb = (pcb_t *)curr->data;
         if (pcb->arrival_time <= c->simulation_time) {
+            // apply backpressure once the input queue is full, holding
+            // back the processes that have arrived
+            if (c->input_bound &&
+                list_len(c->input_queue) >= c->input_bound) {
+                for (; curr; curr = curr->next) {
+                    pcb = (pcb_t *)curr->data;
+                    if (pcb->arrival_time > c->simulation_time) {
+                        break;
+                    }
+                    if (pcb->deferred_since == NOT_DEFERRED) {
+                        pcb->deferred_since = c->simulation_time;
+                    }
+                }
+                break;
+            }
+            if (pcb->deferred_since != NOT_DEFERRED) {
+                pcb->deferred_time = c->simulation_time - pcb->deferred_since;
+            }
+
+            // the scheduler may reject processes that cannot meet their
+            // deadlines
+            if (!admit_process(c, pcb)) {
+                continue;
+            }
             if (DEBUG) {
                 printf("ACTION: Adding process %s to input queue\n", pcb->name);
             }
             move_data(pcb, c->submitted_queue, c->input_queue);
             pcb->state = NEW;
 
-            // task4: initialise process
+            // task4: initialise process, which is spawned lazily when
+            // it is first started
             initialise_process(pcb);
+            if (list_len(c->input_queue) > c->max_input_len) {
+                c->max_input_len = list_len(c->input_queue);
+            }
         } else {
             // assume that the processes are sorted by arrival time,
             // so if the current process has not arrived, none of the
@@ -238,6 +557,53 @@ void manage_arrival(cycle_t *c) {
     }
 }
 
+static int cmp_arrival_time(const void *a, const void *b) {
+    /*  Compare processes by arrival time, then by the order in which they
+        were submitted so that the order is stable.
+     */
+    const pcb_t *pa = *(pcb_t *const *)a, *pb = *(pcb_t *const *)b;
+    if (pa->arrival_time != pb->arrival_time) {
+        return pa->arrival_time < pb->arrival_time ? -1 : 1;
+    }
+    return pa->seq < pb->seq ? -1 : pa->seq > pb->seq;
+}
+
+void drain_arrivals(cycle_t *c) {
+    /*  Move the processes submitted to the arrivals queue, possibly by other
+        threads, to the submitted queue, keeping it in order of arrival
+        time. Processes submitted from different threads are only ordered
+        by arrival time, and processes with the same arrival time keep the
+        order in which they were submitted.
+     */
+    int n;
+    pcb_t **pcbs = (pcb_t **)mpsc_drain(c->arrivals, &n);
+    if (n == 0) {
+        return;
+    }
+
+    // the sequence number of a process is only assigned once it is ready,
+    // so reuse it to record the order of submission
+    for (int i = 0; i < n; i++) {
+        pcbs[i]->seq = (uint64_t)i;
+    }
+    qsort(pcbs, n, sizeof(*pcbs), cmp_arrival_time);
+
+    // merge into the submitted queue from its end, where processes
+    // submitted since the last cycle usually belong
+    for (int i = 0; i < n; i++) {
+        node_t *prev = c->submitted_queue->foot;
+        while (prev &&
+               ((pcb_t *)prev->data)->arrival_time > pcbs[i]->arrival_time) {
+            prev = prev->prev;
+        }
+        if (prev) {
+            insert_next(c->submitted_queue, prev, pcbs[i]);
+        } else {
+            prepend(c->submitted_queue, pcbs[i]);
+        }
+    }
+}
+
 void infinite(cycle_t *c) {
     /*  Move all processes in the input queue to the ready queue assuming
         that there is infinite memory.
@@ -256,8 +622,10 @@ void infinite(cycle_t *c) {
         if (DEBUG) {
             printf("ACTION: Adding process %s to ready queue\n", pcb->name);
         }
-        move_data(pcb, c->input_queue, c->ready_queue);
+        move_to_ready(c, pcb, c->input_queue);
         pcb->state = READY;
+        pcb->admission_time = c->simulation_time;
+        enqueue_ready(c, pcb);
     }
 }
 
@@ -268,9 +636,17 @@ void bestfit(cycle_t *c) {
      */
 
     // copy input queue to a temporary queue so that for loops
-    // can be used to iterate through the input queue
+    // can be used to iterate through the input queue, in the order of the
+    // admission policy
     list_t *temp_queue = create_empty_list();
     copy_list(c->input_queue, temp_queue);
+    order_admission(c, temp_queue);
+
+    // processes that were swapped out are swapped back in before any new
+    // process is admitted
+    if (c->args->swap) {
+        swap_in(c);
+    }
 
     // try to allocate memory for each process in the input queue
     for (node_t *curr = temp_queue->head; curr != NULL; curr = curr->next) {
@@ -278,8 +654,15 @@ void bestfit(cycle_t *c) {
 
         // try to allocate memory
         pcb->memory = (block_t *)mm_malloc(c->memory, pcb->memory_size);
+        if (!pcb->memory && c->args->swap && swap_out(c, pcb->memory_size)) {
+            pcb->memory = (block_t *)mm_malloc(c->memory, pcb->memory_size);
+        }
         if (!pcb->memory) {
-            // memory allocation failed, skip to next process
+            // memory allocation failed, skip to next process, unless the
+            // process reserves memory for itself by holding back the rest
+            if (strcmp(c->admission, RESERVE) == 0) {
+                break;
+            }
             continue;
         }
 
@@ -291,14 +674,221 @@ void bestfit(cycle_t *c) {
         }
         printf("%" PRIu32 ",READY,process_name=%s,assigned_at=%" PRIu16 "\n",
                c->simulation_time, pcb->name, pcb->memory->location);
-        move_data(pcb, c->input_queue, c->ready_queue);
+        trace_alloc(pcb->name, pcb->memory, c->simulation_time);
+        move_to_ready(c, pcb, c->input_queue);
         pcb->state = READY;
+        pcb->admission_time = c->simulation_time;
+        pcb->resident_since = c->simulation_time;
+        enqueue_ready(c, pcb);
     }
 
     // free temporary queue
     free_list(temp_queue, NULL);
 }
 
+uint64_t swap_transfer(cycle_t *c, uint16_t size) {
+    /*  Queue a transfer of `size` to or from the backing store, and return
+        the time in milliseconds at which it completes.
+     */
+    uint64_t start = (uint64_t)c->simulation_time * 1000;
+    if (c->swap_busy_until > start) {
+        start = c->swap_busy_until;
+    }
+    uint64_t cost = SWAP_LATENCY + (uint64_t)size * 1000 / SWAP_BANDWIDTH;
+    c->swap_busy_until = start + cost;
+    c->swap_busy += cost;
+    return c->swap_busy_until;
+}
+
+int swap_out(cycle_t *c, uint16_t size) {
+    /*  Swap out processes waiting in the ready queue, from the back of the
+        queue, until a block of `size` is free. Only processes that have
+        been in memory for SWAP_MIN_RESIDENCE seconds are swapped out, and
+        none are unless enough memory would then be free in total. Return
+        TRUE if a block of `size` is free.
+     */
+    uint32_t available = c->memory->free_bytes;
+    for (node_t *curr = c->ready_queue->head; curr; curr = curr->next) {
+        pcb_t *pcb = (pcb_t *)curr->data;
+        if (c->simulation_time - pcb->resident_since >= SWAP_MIN_RESIDENCE) {
+            available += pcb->memory_size;
+        }
+    }
+    if (available < size) {
+        return FALSE;
+    }
+
+    node_t *curr = c->ready_queue->foot;
+    while (curr && mm_largest_free(c->memory) < size) {
+        node_t *prev = curr->prev;
+        pcb_t *pcb = (pcb_t *)curr->data;
+        if (c->simulation_time - pcb->resident_since >= SWAP_MIN_RESIDENCE) {
+            printf("%" PRIu32 ",SWAPPED-OUT,process_name=%s\n",
+                   c->simulation_time, pcb->name);
+            trace_free(pcb->memory, c->simulation_time);
+            mm_free(c->memory, pcb->memory);
+            pcb->memory = NULL;
+            move_from_ready(c, pcb, c->swapped_queue);
+            swap_transfer(c, pcb->memory_size);
+            c->swap_outs++;
+            c->swapped_out += pcb->memory_size;
+        }
+        curr = prev;
+    }
+    return mm_largest_free(c->memory) >= size;
+}
+
+void swap_in(cycle_t *c) {
+    /*  Start swapping in each swapped out process that fits in memory, in
+        the order they were swapped out, and return the processes whose
+        transfer has completed to the ready queue.
+     */
+    uint64_t now = (uint64_t)c->simulation_time * 1000;
+    node_t *curr = c->swapped_queue->head;
+    while (curr) {
+        node_t *next = curr->next;
+        pcb_t *pcb = (pcb_t *)curr->data;
+        if (!pcb->memory) {
+            pcb->memory = (block_t *)mm_malloc(c->memory, pcb->memory_size);
+            if (!pcb->memory) {
+                curr = next;
+                continue;
+            }
+            trace_alloc(pcb->name, pcb->memory, c->simulation_time);
+            pcb->swap_done = swap_transfer(c, pcb->memory_size);
+            pcb->resident_since = c->simulation_time;
+            c->swap_ins++;
+            c->swapped_in += pcb->memory_size;
+        }
+        if (pcb->swap_done <= now) {
+            printf("%" PRIu32
+                   ",SWAPPED-IN,process_name=%s,assigned_at=%" PRIu16 "\n",
+                   c->simulation_time, pcb->name, pcb->memory->location);
+            c->swap_delay += c->simulation_time - pcb->resident_since;
+            pcb->resident_since = c->simulation_time;
+            move_to_ready(c, pcb, c->swapped_queue);
+            enqueue_ready(c, pcb);
+        }
+        curr = next;
+    }
+}
+
+void paged(cycle_t *c) {
+    /*  Move all processes in the input queue to the ready queue with a page
+        table each. No page is resident until it is first referenced, so
+        memory may be over-committed.
+     */
+    while (c->input_queue->head) {
+        pcb_t *pcb = (pcb_t *)c->input_queue->head->data;
+        uint32_t n_pages = (pcb->memory_size + PAGE_SIZE - 1) / PAGE_SIZE;
+        pcb->pages = pm_create_table(c->paged_memory, n_pages);
+
+        // seed the page references of the process from its name and
+        // arrival time, so that they are the same in every run
+        pcb->page_seed = 2166136261u ^ pcb->arrival_time;
+        for (char *p = pcb->name; *p; p++) {
+            pcb->page_seed = (pcb->page_seed ^ (uint8_t)*p) * 16777619u;
+        }
+        if (pcb->page_seed == 0) {
+            pcb->page_seed = 1;
+        }
+        printf("%" PRIu32 ",READY,process_name=%s,pages=%" PRIu32 "\n",
+               c->simulation_time, pcb->name, n_pages);
+        move_to_ready(c, pcb, c->input_queue);
+        pcb->state = READY;
+        pcb->admission_time = c->simulation_time;
+        enqueue_ready(c, pcb);
+    }
+}
+
+uint32_t reference_pages(cycle_t *c, pcb_t *pcb, uint32_t seconds) {
+    /*  Make the page references of a process that ran for `seconds`, and
+        return the whole seconds of the cycle it spent stalled on page
+        faults instead. The rest of the stall is carried over to its next
+        cycle.
+     */
+    page_table_t *table = pcb->pages;
+    if (table->n_pages == 0) {
+        return 0;
+    }
+    uint32_t hot = table->n_pages * PAGE_HOT_SET_PERCENT / 100;
+    if (hot == 0) {
+        hot = 1;
+    }
+    for (uint32_t i = 0; i < seconds * PAGE_REFERENCES; i++) {
+        // xorshift32
+        uint32_t x = pcb->page_seed;
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        pcb->page_seed = x;
+        uint32_t page = x % 100 < PAGE_HOT_PERCENT
+                            ? (x >> 8) % hot
+                            : (x >> 8) % table->n_pages;
+        pcb->page_references++;
+        if (pm_access(c->paged_memory, table, page)) {
+            pcb->page_faults++;
+            pcb->stall += PAGE_FAULT_COST;
+        }
+        if (table->resident > pcb->max_resident) {
+            pcb->max_resident = table->resident;
+        }
+    }
+    uint32_t stalled = pcb->stall / 1000;
+    if (stalled > seconds) {
+        stalled = seconds;
+    }
+    pcb->stall -= stalled * 1000;
+    return stalled;
+}
+
+static int cmp_memory_size(const void *a, const void *b) {
+    /*  Compare processes by memory size, then by their position in the
+        input queue so that the order is stable.
+     */
+    const pcb_t *pa = *(pcb_t *const *)a, *pb = *(pcb_t *const *)b;
+    if (pa->memory_size != pb->memory_size) {
+        return pa->memory_size < pb->memory_size ? -1 : 1;
+    }
+    return pa->seq < pb->seq ? -1 : pa->seq > pb->seq;
+}
+
+void order_admission(cycle_t *c, list_t *queue) {
+    /*  Order a copy of the input queue by the admission policy.
+
+        fifo and reserve keep the order of arrival, smallest admits the
+        processes that need the least memory first and largest those that
+        need the most, so that big processes are not starved by a stream of
+        small ones.
+     */
+    if (strcmp(c->admission, SMALLEST) != 0 &&
+        strcmp(c->admission, LARGEST) != 0) {
+        return;
+    }
+    int n = list_len(queue);
+    if (n < 2) {
+        return;
+    }
+    pcb_t **pcbs = (pcb_t **)malloc(n * sizeof(*pcbs));
+    assert(pcbs);
+
+    // the sequence number of a process is only assigned once it is ready,
+    // so reuse it to record the position in the input queue
+    for (int i = 0; i < n; i++) {
+        pcbs[i] = (pcb_t *)pop(queue);
+        pcbs[i]->seq = (uint64_t)i;
+    }
+    qsort(pcbs, n, sizeof(*pcbs), cmp_memory_size);
+    for (int i = 0; i < n; i++) {
+        if (strcmp(c->admission, LARGEST) == 0) {
+            prepend(queue, pcbs[i]);
+        } else {
+            append(queue, pcbs[i]);
+        }
+    }
+    free(pcbs);
+}
+
 void sjf(cycle_t *c) {
     /*  Shortest Job First (SJF) scheduling algorithm.
 
@@ -343,7 +933,8 @@ void sjf(cycle_t *c) {
         printf("%" PRIu32 ",RUNNING,process_name=%s,remaining_time=%" PRIu32
                "\n",
                c->simulation_time, pcb->name, pcb->remaining_time);
-        move_data(min->data, c->ready_queue, c->running_queue);
+        c->context_switches++;
+        move_from_ready(c, pcb, c->running_queue);
         pcb->state = RUNNING;
 
         // task4: start process
@@ -387,7 +978,7 @@ void rr(cycle_t *c) {
             if (DEBUG) {
                 printf("ACTION: Suspending process %s\n", pcb->name);
             }
-            move_data(pcb, c->running_queue, c->ready_queue);
+            move_to_ready(c, pcb, c->running_queue);
             pcb->state = SUSPENDED;
 
             // task4: suspend process
@@ -404,7 +995,8 @@ void rr(cycle_t *c) {
         printf("%" PRIu32 ",RUNNING,process_name=%s,remaining_time=%" PRIu32
                "\n",
                c->simulation_time, pcb->name, pcb->remaining_time);
-        move_data(pcb, c->ready_queue, c->running_queue);
+        c->context_switches++;
+        move_from_ready(c, pcb, c->running_queue);
 
         // task4: start process or resume process
         big_endian(c->simulation_time, c->big_endian);
@@ -431,17 +1023,45 @@ cycle_t *create_cycle(args_t *args) {
     assert(c);
 
     // initialise the cycle
-    c->quantum = (uint32_t)atoi(args->quantum);
+    // the quantum is the length of the current cycle, and the base quantum
+    // is 0 if it is adaptive
+    c->base_quantum = (uint32_t)atoi(args->quantum);
+    c->quantum = c->base_quantum ? c->base_quantum : ADAPTIVE_MIN_QUANTUM;
+    c->context_switches = 0;
     c->simulation_time = 0;
+    c->arrived_until = 0;
+    c->cycles = 0;
+    c->total_latency = 0;
+    c->max_latency = 0;
     c->big_endian = calloc(BIG_ENDIAN_BYTES, sizeof(char));
     assert(c->big_endian);
     c->args = args;
     c->memory = mm_init(MAX_MEMORY);
+    c->paged_memory = NULL;
+    c->memory_series =
+        args->memory_series ? create_series(MEMORY_COLUMNS) : NULL;
+    if (strcmp(args->memory, PAGED) == 0) {
+        c->paged_memory = pm_init(MAX_MEMORY / PAGE_SIZE, args->replacement);
+    }
+    c->arrivals = create_mpsc();
     c->submitted_queue = create_empty_list();
     c->input_queue = create_empty_list();
     c->ready_queue = create_empty_list();
     c->running_queue = create_empty_list();
     c->finished_queue = create_empty_list();
+    c->rejected_queue = create_empty_list();
+    c->swapped_queue = create_empty_list();
+    c->swap_busy_until = 0;
+    c->swap_busy = 0;
+    c->swap_delay = 0;
+    c->swap_outs = 0;
+    c->swap_ins = 0;
+    c->swapped_out = 0;
+    c->swapped_in = 0;
+    c->admission = args->admission ? args->admission : DEFAULT_ADMISSION;
+    c->input_bound = args->input_bound ? atoi(args->input_bound) : 0;
+    c->max_input_len = 0;
+    init_scheduler(c);
 
     return c;
 }
@@ -450,13 +1070,23 @@ void free_cycle(cycle_t *c) {
     /*  Free a cycle struct.
      */
     free(c->big_endian);
+    free_scheduler(c);
     // assume the memory manager has no more memory allocated
-    free_list(c->memory, free);
+    mm_destroy(c->memory);
+    if (c->memory_series) {
+        free_series(c->memory_series);
+    }
+    if (c->paged_memory) {
+        pm_free(c->paged_memory);
+    }
+    free_mpsc(c->arrivals, NULL);
     free_list(c->submitted_queue, NULL);
     free_list(c->input_queue, NULL);
     free_list(c->ready_queue, NULL);
     free_list(c->running_queue, NULL);
     free_list(c->finished_queue, NULL);
+    free_list(c->rejected_queue, NULL);
+    free_list(c->swapped_queue, NULL);
     free(c);
 }
 
@@ -470,6 +1100,190 @@ void print_performance_statistics(cycle_t *c) {
            average_time_overhead(c->finished_queue), c->simulation_time);
 }
 
+void print_admission_statistics(cycle_t *c) {
+    /*  Print the throughput in processes per second of simulation time, the
+        maximum and average time processes waited in the input queue and
+        before it, and the number of processes held back by the bound on
+        the input queue, the total time they were held back and the longest
+        the input queue became.
+     */
+    uint32_t max_wait = 0, deferred_time = 0;
+    uint64_t total_wait = 0;
+    int finished = list_len(c->finished_queue), deferred = 0;
+    for (node_t *curr = c->finished_queue->head; curr; curr = curr->next) {
+        pcb_t *pcb = (pcb_t *)curr->data;
+        uint32_t wait = pcb->admission_time - pcb->arrival_time;
+        total_wait += wait;
+        if (wait > max_wait) {
+            max_wait = wait;
+        }
+    }
+    list_t *queues[] = {c->finished_queue, c->rejected_queue};
+    for (int i = 0; i < 2; i++) {
+        for (node_t *curr = queues[i]->head; curr; curr = curr->next) {
+            pcb_t *pcb = (pcb_t *)curr->data;
+            if (pcb->deferred_since != NOT_DEFERRED) {
+                deferred++;
+                deferred_time += pcb->deferred_time;
+            }
+        }
+    }
+    printf("Throughput %.4f\nInput wait %" PRIu32 " %.2f\n",
+           c->simulation_time ? finished / (double)c->simulation_time : 0,
+           max_wait, finished ? total_wait / (double)finished : 0);
+    printf("Backpressure %d %" PRIu32 " %d\n", deferred, deferred_time,
+           c->max_input_len);
+}
+
+void print_paging_statistics(cycle_t *c) {
+    /*  Print the page references, page faults, fault rate and largest
+        resident set (in pages) of each process, followed by the total
+        faults and fault rate, the number of evictions and the maximum and
+        average of the largest resident sets.
+     */
+    uint64_t references = 0, faults = 0;
+    uint32_t max_resident = 0;
+    double total_resident = 0;
+    int finished = list_len(c->finished_queue);
+    for (node_t *curr = c->finished_queue->head; curr; curr = curr->next) {
+        pcb_t *pcb = (pcb_t *)curr->data;
+        printf("PAGING,process_name=%s,references=%" PRIu64
+               ",faults=%" PRIu64 ",fault_rate=%.4f,max_resident=%" PRIu32
+               "\n",
+               pcb->name, pcb->page_references, pcb->page_faults,
+               pcb->page_references
+                   ? pcb->page_faults / (double)pcb->page_references
+                   : 0,
+               pcb->max_resident);
+        references += pcb->page_references;
+        faults += pcb->page_faults;
+        total_resident += pcb->max_resident;
+        if (pcb->max_resident > max_resident) {
+            max_resident = pcb->max_resident;
+        }
+    }
+    printf("Page faults %" PRIu64 " %.4f\nEvictions %" PRIu64
+           "\nResident set %" PRIu32 " %.2f\n",
+           faults, references ? faults / (double)references : 0,
+           c->paged_memory->evictions, max_resident,
+           finished ? total_resident / finished : 0);
+}
+
+void print_swap_statistics(cycle_t *c) {
+    /*  Print the number of processes swapped out and in with the memory
+        they moved, the seconds the backing store was busy, and the total
+        seconds processes waited in memory for their swap in to complete.
+     */
+    printf("Swapped out %d %" PRIu64 "\nSwapped in %d %" PRIu64
+           "\nSwap time %.2f %" PRIu64 "\n",
+           c->swap_outs, c->swapped_out, c->swap_ins, c->swapped_in,
+           c->swap_busy / 1000.0, c->swap_delay);
+}
+
+void sample_memory(cycle_t *c) {
+    /*  Add a sample of the free memory and its fragmentation after a cycle,
+        with the length of the input queue and the number of processes in it
+        that would fit in the free memory if it were not fragmented.
+     */
+    memory_t *memory = c->memory;
+    int fragmented = 0;
+    for (node_t *curr = c->input_queue->head; curr; curr = curr->next) {
+        pcb_t *pcb = (pcb_t *)curr->data;
+        if (pcb->memory_size > memory->largest_free &&
+            pcb->memory_size <= memory->free_bytes) {
+            fragmented++;
+        }
+    }
+    double values[] = {c->simulation_time,
+                       memory->free_bytes,
+                       memory->largest_free,
+                       memory->free_fragments,
+                       mm_fragmentation(memory),
+                       1 - memory->free_bytes / (double)memory->size,
+                       list_len(c->input_queue),
+                       fragmented};
+    series_add(c->memory_series, values);
+}
+
+void print_usage_statistics(cycle_t *c) {
+    /*  Print the real resource usage of each process next to its simulated
+        service and turnaround times, with the wall time it was alive for,
+        followed by the total CPU time, the largest maximum resident set
+        size (in KB) and the total voluntary and involuntary context
+        switches. Then print the system calls made to control
+        processes in total and per cycle, the maximum and average wall
+        time of a cycle in microseconds, and how processes were controlled
+        with the latency of suspending and resuming them.
+     */
+    usage_t total = {0};
+    for (node_t *curr = c->finished_queue->head; curr; curr = curr->next) {
+        pcb_t *pcb = (pcb_t *)curr->data;
+        usage_t *usage = &pcb->process->usage;
+        printf("USAGE,process_name=%s,service_time=%" PRIu32
+               ",turnaround_time=%" PRIu32
+               ",cpu_time=%.6f,elapsed_time=%.6f,max_rss=%ld,"
+               "voluntary_switches=%ld,involuntary_switches=%ld,spawns=%d\n",
+               pcb->name, pcb->service_time,
+               pcb->termination_time - pcb->arrival_time, usage->cpu_time,
+               usage->elapsed_time, usage->max_rss, usage->voluntary_switches,
+               usage->involuntary_switches, usage->spawns);
+        total.cpu_time += usage->cpu_time;
+        if (usage->max_rss > total.max_rss) {
+            total.max_rss = usage->max_rss;
+        }
+        total.voluntary_switches += usage->voluntary_switches;
+        total.involuntary_switches += usage->involuntary_switches;
+    }
+    printf("Real CPU time %.6f\nMax RSS %ld\nReal context switches %ld %ld\n",
+           total.cpu_time, total.max_rss, total.voluntary_switches,
+           total.involuntary_switches);
+    printf("Process syscalls %ld %.2f\nCycle latency %.2f %.2f\n",
+           count_syscalls(), count_syscalls() / (double)c->cycles,
+           c->max_latency, c->total_latency / c->cycles);
+    print_control_statistics();
+}
+
+void print_placement_statistics(cycle_t *c) {
+    /*  Print the CPU each process was pinned to with its node, and how
+        often it migrated between CPUs and between nodes, followed by the
+        placement of the manager and processes, and the total migrations.
+        Then, for processes that never left their node and for those that
+        did, print how many there are with their mean real CPU time and
+        wall time in milliseconds per second of simulated service time.
+     */
+    usage_t total = {0};
+    int count[2] = {0};
+    double cpu_ms[2] = {0};
+    double elapsed_ms[2] = {0};
+    for (node_t *curr = c->finished_queue->head; curr; curr = curr->next) {
+        pcb_t *pcb = (pcb_t *)curr->data;
+        process_t *process = pcb->process;
+        usage_t *usage = &process->usage;
+        printf("PLACEMENT,process_name=%s,cpu=%d,node=%d,migrations=%ld,"
+               "cross_node_migrations=%ld\n",
+               pcb->name, process->cpu,
+               process->cpu == NO_CPU ? NO_CPU : cpu_node(process->cpu),
+               usage->migrations, usage->cross_node_migrations);
+        total.migrations += usage->migrations;
+        total.cross_node_migrations += usage->cross_node_migrations;
+        int crossed = usage->cross_node_migrations > 0;
+        count[crossed]++;
+        cpu_ms[crossed] += usage->cpu_time * 1e3 / pcb->service_time;
+        elapsed_ms[crossed] += usage->elapsed_time * 1e3 / pcb->service_time;
+    }
+    if (is_placing()) {
+        print_placement_topology();
+    }
+    printf("Migrations %ld %ld\n", total.migrations,
+           total.cross_node_migrations);
+    const char *names[] = {"same-node", "cross-node"};
+    for (int i = 0; i < 2; i++) {
+        printf("Runtime %s %d %.2f %.2f\n", names[i], count[i],
+               count[i] ? cpu_ms[i] / count[i] : 0,
+               count[i] ? elapsed_ms[i] / count[i] : 0);
+    }
+}
+
 uint32_t average_turnaround_time(list_t *finished_queue) {
     /*  Average time (in seconds, rounded up to an integer) between the time
         when the process is completed and when it arrived.
@@ -482,7 +1296,10 @@ uint32_t average_turnaround_time(list_t *finished_queue) {
         curr = curr->next;
     }
     int total_pcbs = list_len(finished_queue);
-    assert(total_pcbs > 0);
+    if (total_pcbs == 0) {
+        // every process was rejected
+        return 0;
+    }
 
     // read more at https://stackoverflow.com/a/2422722
     turnaround = (turnaround + total_pcbs - 1) / total_pcbs;
@@ -528,13 +1345,28 @@ float average_time_overhead(list_t *finished_queue) {
         curr = curr->next;
     }
     int total_pcbs = list_len(finished_queue);
-    assert(total_pcbs > 0);
+    if (total_pcbs == 0) {
+        // every process was rejected
+        return 0;
+    }
 
     average_overhead = overhead / total_pcbs;
 
     return average_overhead;
 }
 
+int read_switch(char *flag, int argc, char *argv[]) {
+    /*  Return TRUE if the given flag, which takes no argument, is present
+        in the argument list. Otherwise, return FALSE.
+    */
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], flag) == 0) {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
 char *read_flag(char *flag, const char *const *valid_args, int argc,
                 char *argv[]) {
     /*  Given a flag and a location in the argument list, return the
@@ -583,7 +1415,34 @@ args_t *parse_args(int argc, char *argv[]) {
     args->file = read_flag("-f", NULL, argc, argv);
     args->scheduler = read_flag("-s", SCHEDULERS, argc, argv);
     args->memory = read_flag("-m", MEMORY_METHODS, argc, argv);
-    args->quantum = read_flag("-q", QUANTUMS, argc, argv);
+    args->quantum = read_flag("-q", NULL, argc, argv);
+    args->live = read_flag("-l", NULL, argc, argv);
+    args->usage = read_switch("-u", argc, argv);
+    args->backend = read_flag("-b", BACKENDS, argc, argv);
+    if (!args->backend) {
+        args->backend = DEFAULT_BACKEND;
+    }
+    args->checkpoint = read_flag("-c", NULL, argc, argv);
+    args->interval = read_flag("-k", NULL, argc, argv);
+    args->restore = read_flag("-r", NULL, argc, argv);
+    args->levels = read_flag("-L", NULL, argc, argv);
+    args->boost = read_flag("-B", NULL, argc, argv);
+    args->history = read_flag("-H", NULL, argc, argv);
+    args->aging = read_flag("-a", NULL, argc, argv);
+    args->admission = read_flag("-A", ADMISSIONS, argc, argv);
+    args->input_bound = read_flag("-Q", NULL, argc, argv);
+    args->swap = read_switch("-S", argc, argv);
+    args->profile = read_flag("-p", NULL, argc, argv);
+    args->trace = read_flag("-T", NULL, argc, argv);
+    args->memory_series = read_flag("-F", NULL, argc, argv);
+    args->daemon = read_flag("-D", NULL, argc, argv);
+    args->realtime = read_flag("-R", NULL, argc, argv);
+    args->cgroup = read_flag("-G", NULL, argc, argv);
+    args->placement = read_flag("-C", PLACEMENTS, argc, argv);
+    args->replacement = read_flag("-P", REPLACEMENTS, argc, argv);
+    if (!args->replacement) {
+        args->replacement = DEFAULT_REPLACEMENT;
+    }
     return args;
 }
 
@@ -17,6 +17,11 @@
 #include "linkedlist.h"
 #include "memorymanager.h"
 #include "process-api.h"
+#include "reaper.h"
+#include "heap.h"
+#include "rbtree.h"
+#include "series.h"
+#include "mpsc.h"
 
 /* structures =============================================================== */
 typedef struct arguments {
@@ -24,37 +29,118 @@ typedef struct arguments {
     char *scheduler;
     char *memory;
     char *quantum;
+    char *live;
+    int usage;
+    char *backend;
+    char *checkpoint;
+    char *interval;
+    char *restore;
+    char *levels;
+    char *boost;
+    char *history;
+    char *aging;
+    char *admission;
+    char *input_bound;
+    char *replacement;
+    int swap;
+    char *profile;
+    char *trace;
+    char *memory_series;
+    char *daemon;
+    char *realtime;
+    char *cgroup;
+    char *placement;
 } args_t;
 
 typedef struct cycle {
     uint32_t quantum;
+    uint32_t base_quantum;
+    uint32_t context_switches;
     uint32_t simulation_time;
+    uint32_t arrived_until;
+    uint32_t cycles;
+    double total_latency;
+    double max_latency;
     char *big_endian;
     args_t *args;
-    list_t *memory;
+    memory_t *memory;
+    paged_memory_t *paged_memory;
+    series_t *memory_series;
+    mpsc_t *arrivals;
     list_t *submitted_queue;
     list_t *input_queue;
     list_t *ready_queue;
     list_t *running_queue;
     list_t *finished_queue;
+    list_t *rejected_queue;
+    list_t *swapped_queue;
+    uint64_t swap_busy_until;
+    uint64_t swap_busy;
+    uint64_t swap_delay;
+    int swap_outs;
+    int swap_ins;
+    uint64_t swapped_out;
+    uint64_t swapped_in;
+    list_t **levels;
+    int n_levels;
+    uint32_t *level_quanta;
+    uint32_t boost_period;
+    uint32_t next_boost;
+    uint64_t ready_seq;
+    heap_t *ready_heap;
+    uint32_t preemptions;
+    rbtree_t *vruntime_tree;
+    uint64_t min_vruntime;
+    list_t *tenants;
+    rbtree_t *tenant_tree;
+    uint64_t tenant_weight;
+    double tenant_share;
+    list_t *history;
+    rbtree_t *history_tree;
+    double estimate;
+    double aging_rate;
+    uint32_t *adaptive_remaining;
+    int adaptive_size;
+    char *admission;
+    int input_bound;
+    int max_input_len;
 } cycle_t;
 
 /* function prototypes ====================================================== */
 void process_manager(args_t *args);
+list_t *read_pcbs(char *file);
 void run_cycles(list_t *process_table, args_t *args);
+void step_cycle(cycle_t *c);
+void print_statistics(cycle_t *c);
 void run_cycle(cycle_t *c);
+void move_to_ready(cycle_t *c, pcb_t *pcb, list_t *from);
+void move_from_ready(cycle_t *c, pcb_t *pcb, list_t *to);
 void manage_termination(cycle_t *c);
 void manage_arrival(cycle_t *c);
+void drain_arrivals(cycle_t *c);
 void infinite(cycle_t *c);
 void bestfit(cycle_t *c);
+uint64_t swap_transfer(cycle_t *c, uint16_t size);
+int swap_out(cycle_t *c, uint16_t size);
+void swap_in(cycle_t *c);
+void paged(cycle_t *c);
+uint32_t reference_pages(cycle_t *c, pcb_t *pcb, uint32_t seconds);
+void order_admission(cycle_t *c, list_t *queue);
+void print_admission_statistics(cycle_t *c);
+void print_paging_statistics(cycle_t *c);
+void print_swap_statistics(cycle_t *c);
+void sample_memory(cycle_t *c);
 void sjf(cycle_t *c);
 void rr(cycle_t *c);
 cycle_t *create_cycle(args_t *args);
 void free_cycle(cycle_t *c);
 void print_performance_statistics(cycle_t *c);
+void print_usage_statistics(cycle_t *c);
+void print_placement_statistics(cycle_t *c);
 uint32_t average_turnaround_time(list_t *finished_queue);
 float max_time_overhead(list_t *finished_queue);
 float average_time_overhead(list_t *finished_queue);
+int read_switch(char *flag, int argc, char *argv[]);
 char *read_flag(char *flag, const char *const *valid_args, int argc,
                 char *argv[]);
 args_t *parse_args(int argc, char *argv[]);
@@ -5,12 +5,19 @@
    API required to manage the memory. The memory manager is implemented
    as a linked list of memory blocks.
 
+   Paged memory is a table of frames and a page table per process. Pages
+   are loaded on demand and, once every frame is in use, a page is evicted
+   by LRU, CLOCK or 2Q. Frames are kept on intrusive lists of frame numbers
+   so that every operation but CLOCK's sweep takes constant time.
+
    Author: David Sha
 ============================================================================= */
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
+#include <string.h>
 #include "memorymanager.h"
+#include "profile.h"
 
 block_t *create_memory_block(int status, uint16_t location, uint16_t size) {
     /*  Create a free memory block.
@@ -21,19 +28,98 @@ block_t *create_memory_block(int status, uint16_t location, uint16_t size) {
     block->status = status;
     block->location = location;
     block->size = size;
+    block->trace_node = NULL;
     return block;
 }
 
-list_t *mm_init(uint16_t size) {
+static void add_free(memory_t *memory, uint16_t size) {
+    /*  Count a free block of `size`.
+     */
+    memory->free_bytes += size;
+    memory->free_fragments++;
+    if (memory->free_sizes[size]++ == 0) {
+        memory->has_free_size[size / 64] |= 1ull << (size % 64);
+    }
+    if (size > memory->largest_free) {
+        memory->largest_free = size;
+    }
+}
+
+static void remove_free(memory_t *memory, uint16_t size) {
+    /*  Stop counting a free block of `size`. If it was the last of the
+        largest free blocks, find the next largest from the bitmap.
+     */
+    assert(memory->free_sizes[size] > 0);
+    memory->free_bytes -= size;
+    memory->free_fragments--;
+    if (--memory->free_sizes[size] > 0) {
+        return;
+    }
+    memory->has_free_size[size / 64] &= ~(1ull << (size % 64));
+    if (size != memory->largest_free) {
+        return;
+    }
+    memory->largest_free = 0;
+    for (int word = size / 64; word >= 0; word--) {
+        if (memory->has_free_size[word]) {
+            memory->largest_free =
+                word * 64 + 63 - __builtin_clzll(memory->has_free_size[word]);
+            break;
+        }
+    }
+}
+
+memory_t *mm_init(uint16_t size) {
     /*  Initialize the memory manager, which is a linked list of memory blocks.
         The `size` parameter is the total size of memory.
      */
-    list_t *memory = create_empty_list();
-    memory = append(memory, create_memory_block(FREE, 0, size));
+    memory_t *memory;
+    memory = (memory_t *)malloc(sizeof(*memory));
+    assert(memory);
+    memory->size = size;
+    memory->free_sizes = (uint32_t *)calloc(size + 1, sizeof(uint32_t));
+    memory->has_free_size = (uint64_t *)calloc(size / 64 + 1, sizeof(uint64_t));
+    assert(memory->free_sizes && memory->has_free_size);
+    memory->blocks = create_empty_list();
+    mm_clear(memory);
+    mm_append(memory, create_memory_block(FREE, 0, size));
     return memory;
 }
 
-block_t *mm_malloc(list_t *memory, uint16_t size) {
+void mm_destroy(memory_t *memory) {
+    /*  Free the memory manager and its blocks.
+     */
+    free_list(memory->blocks, free);
+    free(memory->free_sizes);
+    free(memory->has_free_size);
+    free(memory);
+}
+
+void mm_clear(memory_t *memory) {
+    /*  Remove every block, so that the blocks can be added again with
+        mm_append, e.g. when restoring a snapshot.
+     */
+    free_list(memory->blocks, free);
+    memory->blocks = create_empty_list();
+    memory->free_bytes = 0;
+    memory->free_fragments = 0;
+    memory->largest_free = 0;
+    memset(memory->free_sizes, 0, (memory->size + 1) * sizeof(uint32_t));
+    memset(memory->has_free_size, 0,
+           (memory->size / 64 + 1) * sizeof(uint64_t));
+}
+
+void mm_append(memory_t *memory, block_t *block) {
+    /*  Add a block after the last block.
+     */
+    assert(block->size <= memory->size);
+    append(memory->blocks, block);
+    if (block->status == FREE) {
+        add_free(memory, block->size);
+    }
+}
+
+block_t *mm_malloc(memory_t *memory, uint16_t size) {
     /*  Allocate memory of size `size` to the process.
         The memory manager will find the best fit block and allocate it.
         If there is no free block that can fit the process, return NULL.
@@ -41,29 +127,36 @@ block_t *mm_malloc(list_t *memory, uint16_t size) {
         If there are two or more best fit blocks, the memory manager will
         allocate the block with the smallest address, i.e. leftmost block.
     */
-    // find the best fit block
+    // find the best fit block, unless no block is large enough
     block_t *min = NULL;
-    for (node_t *curr = memory->head; curr; curr = curr->next) {
-        block_t *block = (block_t *)curr->data;
-        if (block->status == FREE && block->size >= size &&
-            (!min || block->size < min->size)) {
-            min = block;
+    if (size <= memory->largest_free) {
+        for (node_t *curr = memory->blocks->head; curr; curr = curr->next) {
+            block_t *block = (block_t *)curr->data;
+            if (block->status == FREE && block->size >= size &&
+                (!min || block->size < min->size)) {
+                min = block;
+            }
         }
     }
 
     // split the block if not perfect fit and allocate
     if (min) {
+        profile.allocations++;
         assert(min->status == FREE);
         if (size < min->size) {
             block_t *new = create_memory_block(ALLOCATED, min->location, size);
+            remove_free(memory, min->size);
             min->size -= size;
             min->location += size;
+            add_free(memory, min->size);
             // get the node of the best fit block
-            node_t *min_node = (node_t *)find_node(memory, min, cmp_addr);
-            insert_prev(memory, min_node, new);
+            node_t *min_node =
+                (node_t *)find_node(memory->blocks, min, cmp_addr);
+            insert_prev(memory->blocks, min_node, new);
             return new;
         } else if (size == min->size) {
             // memory block is exactly the size of the process
+            remove_free(memory, min->size);
             min->status = ALLOCATED;
             return min;
         } else {
@@ -73,10 +166,11 @@ block_t *mm_malloc(list_t *memory, uint16_t size) {
         }
     }
 
+    profile.failed_allocations++;
     return NULL;
 }
 
-void mm_free(list_t *memory, block_t *block) {
+void mm_free(memory_t *memory, block_t *block) {
     /*  Free the memory block.
         The memory manager will merge the block with its adjacent free blocks.
         If the block is already free, do nothing.
@@ -86,8 +180,9 @@ void mm_free(list_t *memory, block_t *block) {
     if (block->status == FREE) {
         return;
     }
+    profile.frees++;
 
-    for (node_t *curr = memory->head; curr; curr = curr->next) {
+    for (node_t *curr = memory->blocks->head; curr; curr = curr->next) {
         block_t *curr_block = (block_t *)curr->data;
 
         if (cmp_addr(curr_block, block) == 0) {
@@ -100,8 +195,9 @@ void mm_free(list_t *memory, block_t *block) {
             if (curr->next) {
                 block_t *next = (block_t *)curr->next->data;
                 if (next->status == FREE) {
+                    remove_free(memory, next->size);
                     curr_block->size += next->size;
-                    remove_node(memory, curr->next);
+                    remove_node(memory->blocks, curr->next);
                     free(next);
                 }
             }
@@ -110,17 +206,38 @@ void mm_free(list_t *memory, block_t *block) {
             if (curr->prev) {
                 block_t *prev = (block_t *)curr->prev->data;
                 if (prev->status == FREE) {
+                    remove_free(memory, prev->size);
                     prev->size += curr_block->size;
-                    remove_node(memory, curr);
+                    remove_node(memory->blocks, curr);
                     free(curr_block);
+                    curr_block = prev;
                 }
             }
+            add_free(memory, curr_block->size);
 
             break;
         }
     }
 }
 
+uint16_t mm_largest_free(memory_t *memory) {
+    /*  Return the size of the largest free block, which is the largest
+        process that can be allocated memory right now.
+     */
+    return memory->largest_free;
+}
+
+double mm_fragmentation(memory_t *memory) {
+    /*  Return the external fragmentation index, the fraction of free memory
+        that is not in the largest free block: 0 if all free memory is in
+        one block, approaching 1 as it is split into many small blocks.
+     */
+    if (memory->free_bytes == 0) {
+        return 0;
+    }
+    return 1 - memory->largest_free / (double)memory->free_bytes;
+}
+
 void print_block(void *data) {
     /*  Print the block.
      */
@@ -128,3 +245,249 @@ void print_block(void *data) {
     printf("%s-%d-%d", block->status == FREE ? "FREED" : "ALLOC",
            block->location, block->size);
 }
+
+static void unlink_frame(paged_memory_t *pm, uint32_t f) {
+    /*  Remove a frame from the list it is on, if any.
+     */
+    frame_t *frame = &pm->frames[f];
+    if (frame->list == NO_LIST) {
+        return;
+    }
+    frame_list_t *list = &pm->lists[frame->list];
+    if (frame->prev == NO_FRAME) {
+        list->head = frame->next;
+    } else {
+        pm->frames[frame->prev].next = frame->next;
+    }
+    if (frame->next == NO_FRAME) {
+        list->foot = frame->prev;
+    } else {
+        pm->frames[frame->next].prev = frame->prev;
+    }
+    list->len--;
+    frame->list = NO_LIST;
+}
+
+static void push_frame(paged_memory_t *pm, int list, uint32_t f) {
+    /*  Add a frame to the head of a list, where the most recently used
+        frames are.
+     */
+    frame_t *frame = &pm->frames[f];
+    if (list == NO_LIST) {
+        return;
+    }
+    frame_list_t *l = &pm->lists[list];
+    frame->list = list;
+    frame->prev = NO_FRAME;
+    frame->next = l->head;
+    if (l->head == NO_FRAME) {
+        l->foot = f;
+    } else {
+        pm->frames[l->head].prev = f;
+    }
+    l->head = f;
+    l->len++;
+}
+
+paged_memory_t *pm_init(uint32_t n_frames, char *policy) {
+    /*  Initialise paged memory of `n_frames` free frames, which evicts pages
+        by the given policy.
+     */
+    assert(n_frames > 0 && n_frames <= PTE_FRAME);
+    paged_memory_t *pm;
+    pm = (paged_memory_t *)malloc(sizeof(*pm));
+    assert(pm);
+    if (strcmp(policy, CLOCK) == 0) {
+        pm->policy = CLOCK_POLICY;
+    } else if (strcmp(policy, TWO_Q) == 0) {
+        pm->policy = TWO_Q_POLICY;
+    } else {
+        pm->policy = LRU_POLICY;
+    }
+    pm->n_frames = n_frames;
+    pm->frames = (frame_t *)malloc(n_frames * sizeof(*pm->frames));
+    assert(pm->frames);
+    for (int i = 0; i < NO_LIST; i++) {
+        pm->lists[i].head = pm->lists[i].foot = NO_FRAME;
+        pm->lists[i].len = 0;
+    }
+    // push in reverse so that the lowest frames are used first
+    for (uint32_t f = n_frames; f-- > 0;) {
+        pm->frames[f].owner = NO_OWNER;
+        pm->frames[f].page = 0;
+        push_frame(pm, FREE_FRAMES, f);
+    }
+    pm->hand = 0;
+    pm->max_ghosts = n_frames * TWO_Q_OUT_PERCENT / 100;
+    if (pm->max_ghosts == 0) {
+        pm->max_ghosts = 1;
+    }
+    pm->ghost_owners = (uint32_t *)malloc(pm->max_ghosts * sizeof(uint32_t));
+    pm->ghost_pages = (uint32_t *)malloc(pm->max_ghosts * sizeof(uint32_t));
+    assert(pm->ghost_owners && pm->ghost_pages);
+    pm->ghost_head = 0;
+    pm->n_ghosts = 0;
+    pm->tables = NULL;
+    pm->n_tables = 0;
+    pm->tables_size = 0;
+    pm->evictions = 0;
+    return pm;
+}
+
+void pm_free(paged_memory_t *pm) {
+    /*  Free paged memory and any page tables that have not been freed.
+     */
+    for (uint32_t i = 0; i < pm->n_tables; i++) {
+        if (pm->tables[i]) {
+            free(pm->tables[i]->entries);
+            free(pm->tables[i]);
+        }
+    }
+    free(pm->tables);
+    free(pm->frames);
+    free(pm->ghost_owners);
+    free(pm->ghost_pages);
+    free(pm);
+}
+
+page_table_t *pm_create_table(paged_memory_t *pm, uint32_t n_pages) {
+    /*  Create the page table of a process of `n_pages` pages, none of which
+        are resident. Entries are allocated zeroed, so the pages of a large
+        table that are never touched take no physical memory.
+     */
+    page_table_t *table;
+    table = (page_table_t *)malloc(sizeof(*table));
+    assert(table);
+    profile.allocations++;
+    table->id = pm->n_tables;
+    table->n_pages = n_pages;
+    table->resident = 0;
+    table->entries = (pte_t *)calloc(n_pages ? n_pages : 1, sizeof(pte_t));
+    assert(table->entries);
+    if (pm->n_tables == pm->tables_size) {
+        pm->tables_size = pm->tables_size ? pm->tables_size * 2 : 4;
+        pm->tables = (page_table_t **)realloc(
+            pm->tables, pm->tables_size * sizeof(*pm->tables));
+        assert(pm->tables);
+    }
+    pm->tables[pm->n_tables++] = table;
+    return table;
+}
+
+void pm_free_table(paged_memory_t *pm, page_table_t *table) {
+    /*  Free a page table and the frames of its resident pages. Ghosts of its
+        pages are ignored from now on, since the table is no longer found
+        by its id.
+     */
+    for (uint32_t page = 0; page < table->n_pages; page++) {
+        pte_t pte = table->entries[page];
+        if (pte & PTE_PRESENT) {
+            uint32_t f = pte & PTE_FRAME;
+            unlink_frame(pm, f);
+            pm->frames[f].owner = NO_OWNER;
+            push_frame(pm, FREE_FRAMES, f);
+        }
+    }
+    pm->tables[table->id] = NULL;
+    profile.frees++;
+    free(table->entries);
+    free(table);
+}
+
+static void add_ghost(paged_memory_t *pm, uint32_t owner, uint32_t page) {
+    /*  Remember a page evicted from A1in, forgetting the oldest ghost if
+        there are too many.
+     */
+    uint32_t slot = (pm->ghost_head + pm->n_ghosts) % pm->max_ghosts;
+    if (pm->n_ghosts == pm->max_ghosts) {
+        page_table_t *table = pm->tables[pm->ghost_owners[slot]];
+        if (table) {
+            table->entries[pm->ghost_pages[slot]] &= ~PTE_GHOST;
+        }
+        pm->ghost_head = (pm->ghost_head + 1) % pm->max_ghosts;
+    } else {
+        pm->n_ghosts++;
+    }
+    pm->ghost_owners[slot] = owner;
+    pm->ghost_pages[slot] = page;
+}
+
+static uint32_t evict(paged_memory_t *pm) {
+    /*  Choose a frame to evict by the replacement policy, and evict the page
+        in it. Only called when every frame is in use.
+     */
+    uint32_t f;
+    int ghost = FALSE;
+    if (pm->policy == CLOCK_POLICY) {
+        // sweep, giving referenced pages a second chance
+        while (TRUE) {
+            f = pm->hand;
+            pm->hand = (pm->hand + 1) % pm->n_frames;
+            pte_t *pte = &pm->tables[pm->frames[f].owner]
+                              ->entries[pm->frames[f].page];
+            if (!(*pte & PTE_REFERENCED)) {
+                break;
+            }
+            *pte &= ~PTE_REFERENCED;
+        }
+    } else if (pm->policy == TWO_Q_POLICY &&
+               (pm->lists[IN_FRAMES].len >
+                    pm->n_frames * TWO_Q_IN_PERCENT / 100 ||
+                pm->lists[HOT_FRAMES].len == 0)) {
+        // pages seen once leave A1in first, and are remembered in A1out
+        f = pm->lists[IN_FRAMES].foot;
+        ghost = TRUE;
+    } else {
+        f = pm->lists[HOT_FRAMES].foot;
+    }
+
+    frame_t *frame = &pm->frames[f];
+    page_table_t *table = pm->tables[frame->owner];
+    table->entries[frame->page] = ghost ? PTE_GHOST : 0;
+    table->resident--;
+    if (ghost) {
+        add_ghost(pm, frame->owner, frame->page);
+    }
+    unlink_frame(pm, f);
+    frame->owner = NO_OWNER;
+    pm->evictions++;
+    return f;
+}
+
+int pm_access(paged_memory_t *pm, page_table_t *table, uint32_t page) {
+    /*  Reference a page of a process. Return TRUE if the reference caused a
+        page fault, in which case the page is loaded into a free frame, or
+        into the frame of an evicted page if there is none.
+     */
+    assert(page < table->n_pages);
+    pte_t *pte = &table->entries[page];
+    if (*pte & PTE_PRESENT) {
+        uint32_t f = *pte & PTE_FRAME;
+        *pte |= PTE_REFERENCED;
+        // A1in is FIFO, so a page referenced again there is not moved
+        if (pm->frames[f].list == HOT_FRAMES) {
+            unlink_frame(pm, f);
+            push_frame(pm, HOT_FRAMES, f);
+        }
+        return FALSE;
+    }
+
+    uint32_t f = pm->lists[FREE_FRAMES].head;
+    if (f == NO_FRAME) {
+        f = evict(pm);
+    } else {
+        unlink_frame(pm, f);
+    }
+    pm->frames[f].owner = table->id;
+    pm->frames[f].page = page;
+    if (pm->policy == CLOCK_POLICY) {
+        pm->frames[f].list = NO_LIST;
+    } else if (pm->policy == TWO_Q_POLICY && !(*pte & PTE_GHOST)) {
+        push_frame(pm, IN_FRAMES, f);
+    } else {
+        push_frame(pm, HOT_FRAMES, f);
+    }
+    *pte = PTE_PRESENT | PTE_REFERENCED | f;
+    table->resident++;
+    return TRUE;
+}
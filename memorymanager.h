@@ -14,18 +14,105 @@
 #include "linkedlist.h"
 #include "config.h"
 
+/* #defines ================================================================= */
+
+/*  A page table entry is a frame number with flags in its top bits, so that
+    page tables take 4 bytes per page.
+ */
+#define PTE_PRESENT 0x80000000u
+#define PTE_REFERENCED 0x40000000u
+#define PTE_GHOST 0x20000000u
+#define PTE_FRAME 0x1FFFFFFFu
+
+/*  End of a list of frames, and owner of a free frame.
+ */
+#define NO_FRAME UINT32_MAX
+#define NO_OWNER UINT32_MAX
+
 /* structures =============================================================== */
 typedef struct block {
     enum { FREE, ALLOCATED } status;
     uint16_t location;
     uint16_t size;
+    node_t *trace_node;
 } block_t;
 
+/*  Contiguous memory, with statistics of its free blocks that are kept up to
+    date on every allocation and free instead of by scanning the blocks.
+ */
+typedef struct memory {
+    list_t *blocks;
+    uint16_t size;
+    uint32_t free_bytes;
+    uint32_t free_fragments;
+    uint16_t largest_free;
+    // number of free blocks of each size, and a bitmap of the sizes that
+    // have any, to find the next largest free block quickly
+    uint32_t *free_sizes;
+    uint64_t *has_free_size;
+} memory_t;
+
+typedef uint32_t pte_t;
+
+typedef struct page_table {
+    uint32_t id;
+    uint32_t n_pages;
+    uint32_t resident;
+    pte_t *entries;
+} page_table_t;
+
+// the list a frame is on: free frames, frames in LRU order (LRU, and Am of
+// 2Q), frames in FIFO order (A1in of 2Q), or none (CLOCK)
+enum { FREE_FRAMES, HOT_FRAMES, IN_FRAMES, NO_LIST };
+
+typedef struct frame {
+    uint32_t owner;
+    uint32_t page;
+    uint32_t prev;
+    uint32_t next;
+    uint8_t list;
+} frame_t;
+
+typedef struct frame_list {
+    uint32_t head;
+    uint32_t foot;
+    uint32_t len;
+} frame_list_t;
+
+typedef struct paged_memory {
+    enum { LRU_POLICY, CLOCK_POLICY, TWO_Q_POLICY } policy;
+    uint32_t n_frames;
+    frame_t *frames;
+    frame_list_t lists[NO_LIST];
+    uint32_t hand;
+    // pages recently evicted from A1in (A1out of 2Q), as a ring
+    uint32_t *ghost_owners;
+    uint32_t *ghost_pages;
+    uint32_t max_ghosts;
+    uint32_t ghost_head;
+    uint32_t n_ghosts;
+    // page tables by id, NULL once freed
+    page_table_t **tables;
+    uint32_t n_tables;
+    uint32_t tables_size;
+    uint64_t evictions;
+} paged_memory_t;
+
 /* function prototypes ====================================================== */
 block_t *create_memory_block(int status, uint16_t location, uint16_t size);
-list_t *mm_init(uint16_t size);
-block_t *mm_malloc(list_t *memory, uint16_t size);
-void mm_free(list_t *memory, block_t *block);
+memory_t *mm_init(uint16_t size);
+void mm_destroy(memory_t *memory);
+void mm_clear(memory_t *memory);
+void mm_append(memory_t *memory, block_t *block);
+block_t *mm_malloc(memory_t *memory, uint16_t size);
+void mm_free(memory_t *memory, block_t *block);
+uint16_t mm_largest_free(memory_t *memory);
+double mm_fragmentation(memory_t *memory);
 void print_block(void *data);
+paged_memory_t *pm_init(uint32_t n_frames, char *policy);
+void pm_free(paged_memory_t *pm);
+page_table_t *pm_create_table(paged_memory_t *pm, uint32_t n_pages);
+void pm_free_table(paged_memory_t *pm, page_table_t *table);
+int pm_access(paged_memory_t *pm, page_table_t *table, uint32_t page);
 
 #endif
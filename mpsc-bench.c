@@ -0,0 +1,260 @@
+/* =============================================================================
+   mpsc-bench.c
+
+   Stress test and benchmark of the lock-free queue in mpsc.c, which feeds
+   processes submitted from other threads to the simulation.
+
+   Usage: ./mpsc-bench [pushes per producer] [max producers]
+
+   For 1, 2, 4, ... up to the given number of producers, every producer
+   thread pushes its own numbered elements while the main thread drains
+   the queue in batches. Every element must be drained exactly once and in
+   the order its producer pushed it, and the depth of the queue must return
+   to 0. The same is then timed against a linked list behind a mutex, and
+   the millions of pushes per second, largest batch and largest depth of
+   the lock-free queue are printed for each number of producers. Both push
+   nodes that the producers allocated before they were timed, as the
+   daemon pushes the node embedded in each process, so neither measures
+   the allocator.
+   Exits with failure if any check fails.
+
+   Author: David Sha
+============================================================================= */
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <time.h>
+#include "mpsc.h"
+
+#define TRUE 1
+#define FALSE 0
+#define MAX_PRODUCERS 64
+
+// list behind a mutex that the lock-free queue is compared with
+typedef struct locked {
+    pthread_mutex_t lock;
+    mpsc_node_t *head;
+    mpsc_node_t *foot;
+} locked_t;
+
+typedef struct producer {
+    pthread_t thread;
+    int id;
+    long pushes;
+    mpsc_node_t *nodes;
+    void *queue;
+} producer_t;
+
+static void *element(int id, long seq) {
+    /*  Encode a producer and the position of an element in a pointer. The
+        element is never 0, so it cannot be mistaken for NULL.
+     */
+    return (void *)(((uintptr_t)id << 40 | (uintptr_t)seq) + 1);
+}
+
+static void locked_push(locked_t *list, mpsc_node_t *node, void *data) {
+    /*  Append an element to the list behind the mutex.
+     */
+    node->data = data;
+    node->next = NULL;
+    pthread_mutex_lock(&list->lock);
+    if (list->foot) {
+        list->foot->next = node;
+    } else {
+        list->head = node;
+    }
+    list->foot = node;
+    pthread_mutex_unlock(&list->lock);
+}
+
+static void *produce(void *arg) {
+    /*  Push the elements of a producer.
+     */
+    producer_t *producer = (producer_t *)arg;
+    for (long i = 0; i < producer->pushes; i++) {
+        if (producer->id < 0) {
+            locked_push((locked_t *)producer->queue, &producer->nodes[i],
+                        element(-producer->id - 1, i));
+        } else {
+            mpsc_push((mpsc_t *)producer->queue, &producer->nodes[i],
+                      element(producer->id, i));
+        }
+    }
+    return NULL;
+}
+
+static int check(long *next, void **batch, int n) {
+    /*  Check that a batch continues the elements of every producer in
+        order. Return the number of elements out of order.
+     */
+    int failed = 0;
+    for (int i = 0; i < n; i++) {
+        uintptr_t value = (uintptr_t)batch[i] - 1;
+        int id = (int)(value >> 40);
+        long seq = (long)(value & (((uintptr_t)1 << 40) - 1));
+        if (id >= MAX_PRODUCERS || seq != next[id]) {
+            failed++;
+            continue;
+        }
+        next[id]++;
+    }
+    return failed;
+}
+
+static double now() {
+    /*  Return the monotonic wall time in seconds.
+     */
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void prepare(producer_t *producers, int n, long pushes,
+                    mpsc_node_t *nodes) {
+    /*  Give each of `n` producers its share of the nodes, touching them so
+        that page faults are not timed either.
+     */
+    for (int i = 0; i < n; i++) {
+        producers[i].pushes = pushes;
+        producers[i].nodes = nodes + i * pushes;
+    }
+    for (long i = 0; i < n * pushes; i++) {
+        nodes[i].next = NULL;
+    }
+}
+
+static void start(producer_t *producers, int n, void *queue, int locked) {
+    /*  Start `n` producers pushing to the lock-free queue or to the list.
+     */
+    for (int i = 0; i < n; i++) {
+        producers[i].id = locked ? -i - 1 : i;
+        producers[i].queue = queue;
+        if (pthread_create(&producers[i].thread, NULL, produce,
+                           &producers[i]) != 0) {
+            perror("pthread_create");
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+static double run_lock_free(int n, long pushes, mpsc_node_t *nodes,
+                            int *failed, int *max_batch, int *max_depth) {
+    /*  Drain `n` producers through the lock-free queue, checking every
+        batch. Return the time taken in seconds.
+     */
+    producer_t producers[MAX_PRODUCERS];
+    long next[MAX_PRODUCERS] = {0};
+    mpsc_t *queue = create_mpsc();
+    long total = n * pushes, drained = 0;
+    prepare(producers, n, pushes, nodes);
+    double begin = now();
+    start(producers, n, queue, FALSE);
+    while (drained < total) {
+        int len;
+        void **batch = mpsc_drain(queue, &len);
+        *failed += check(next, batch, len);
+        drained += len;
+    }
+    double elapsed = now() - begin;
+    for (int i = 0; i < n; i++) {
+        pthread_join(producers[i].thread, NULL);
+        if (next[i] != pushes) {
+            (*failed)++;
+        }
+    }
+    if (mpsc_depth(queue) != 0 || queue->drained != (uint64_t)total) {
+        (*failed)++;
+    }
+    *max_batch = queue->max_batch;
+    *max_depth = atomic_load(&queue->max_depth);
+    free_mpsc(queue, NULL);
+    return elapsed;
+}
+
+static double run_locked(int n, long pushes, mpsc_node_t *nodes,
+                         int *failed) {
+    /*  Drain `n` producers through the list behind a mutex, taking the
+        whole list at once like the lock-free queue. Return the time taken
+        in seconds.
+     */
+    producer_t producers[MAX_PRODUCERS];
+    long next[MAX_PRODUCERS] = {0};
+    locked_t list = {.lock = PTHREAD_MUTEX_INITIALIZER};
+    long total = n * pushes, drained = 0;
+    void **batch = NULL;
+    int size = 0;
+    prepare(producers, n, pushes, nodes);
+    double begin = now();
+    start(producers, n, &list, TRUE);
+    while (drained < total) {
+        pthread_mutex_lock(&list.lock);
+        mpsc_node_t *node = list.head;
+        list.head = list.foot = NULL;
+        pthread_mutex_unlock(&list.lock);
+        int len = 0;
+        while (node) {
+            mpsc_node_t *next_node = node->next;
+            if (len == size) {
+                size = size ? size * 2 : 16;
+                batch = (void **)realloc(batch, size * sizeof(void *));
+                assert(batch);
+            }
+            batch[len++] = node->data;
+            node = next_node;
+        }
+        *failed += check(next, batch, len);
+        drained += len;
+    }
+    double elapsed = now() - begin;
+    for (int i = 0; i < n; i++) {
+        pthread_join(producers[i].thread, NULL);
+        if (next[i] != pushes) {
+            (*failed)++;
+        }
+    }
+    free(batch);
+    return elapsed;
+}
+
+static int next_producers(int n, int max) {
+    /*  Return the next number of producers to run: double, but end with
+        `max` if it is not a power of 2.
+     */
+    return n < max && n * 2 > max ? max : n * 2;
+}
+
+int main(int argc, char *argv[]) {
+    long pushes = argc > 1 ? atol(argv[1]) : 1000000;
+    int max_producers = argc > 2 ? atoi(argv[2]) : 8;
+    if (pushes <= 0 || max_producers <= 0 || max_producers > MAX_PRODUCERS) {
+        fprintf(stderr, "Usage: %s [pushes per producer] [max producers "
+                        "up to %d]\n",
+                argv[0], MAX_PRODUCERS);
+        exit(EXIT_FAILURE);
+    }
+
+    // nodes for every push of the largest run, reused by every run
+    mpsc_node_t *nodes;
+    nodes = (mpsc_node_t *)malloc(max_producers * pushes * sizeof(*nodes));
+    assert(nodes);
+
+    int failed = 0;
+    printf("producers  lock-free  mutex  max batch  max depth\n");
+    for (int n = 1; n <= max_producers; n = next_producers(n, max_producers)) {
+        int errors = 0, max_batch, max_depth;
+        double lock_free =
+            run_lock_free(n, pushes, nodes, &errors, &max_batch, &max_depth);
+        double locked = run_locked(n, pushes, nodes, &errors);
+        if (errors) {
+            printf("%9d  FAILED with %d elements out of order\n", n, errors);
+            failed = 1;
+            continue;
+        }
+        printf("%9d  %9.2f  %5.2f  %9d  %9d\n", n, n * pushes / lock_free / 1e6,
+               n * pushes / locked / 1e6, max_batch, max_depth);
+    }
+    free(nodes);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,142 @@
+/* =============================================================================
+   mpsc.c
+
+   Lock-free multi-producer single-consumer queue that allows any data type
+   to be stored. Producers push onto a stack with a compare-and-swap on its
+   head, so they never wait on a lock or on each other for longer than a
+   retry. The consumer takes the whole stack with a single exchange and
+   reverses it, so every drain returns a batch in the order the elements
+   were pushed. Since the consumer never removes single nodes, the stack is
+   not subject to the ABA problem.
+
+   Nodes belong to the caller, which pushes each element with a node of its
+   own that must stay valid until the element is drained, so neither
+   pushing nor draining calls the allocator. A node may be pushed again
+   once its element has been drained.
+
+   The queue counts the elements waiting, the largest number waiting at
+   once, and the elements and batches drained with the largest batch.
+
+   Reference:
+   - R. Kent Treiber, "Systems Programming: Coping with Parallelism", 1986.
+
+   Author: David Sha
+============================================================================= */
+#include <assert.h>
+#include <stdlib.h>
+#include "mpsc.h"
+
+#define INITIAL_BATCH_SIZE 16
+
+mpsc_t *create_mpsc() {
+    /*  Create an empty queue.
+     */
+    mpsc_t *queue;
+    queue = (mpsc_t *)malloc(sizeof(*queue));
+    assert(queue);
+    atomic_init(&queue->head, NULL);
+    atomic_init(&queue->depth, 0);
+    atomic_init(&queue->max_depth, 0);
+    queue->batch = (void **)malloc(INITIAL_BATCH_SIZE * sizeof(void *));
+    assert(queue->batch);
+    queue->batch_size = INITIAL_BATCH_SIZE;
+    queue->max_batch = 0;
+    queue->batches = 0;
+    queue->drained = 0;
+    return queue;
+}
+
+void free_mpsc(mpsc_t *queue, void (*free_data)(void *data)) {
+    /*  Free the queue and, if a function pointer is given, the data still
+        in it. The nodes belong to the caller and are not freed. No producer
+        may push concurrently.
+     */
+    assert(queue);
+    mpsc_node_t *node = atomic_load(&queue->head);
+    while (node) {
+        mpsc_node_t *next = node->next;
+        if (free_data) {
+            free_data(node->data);
+        }
+        node = next;
+    }
+    free(queue->batch);
+    free(queue);
+}
+
+void mpsc_push(mpsc_t *queue, mpsc_node_t *node, void *data) {
+    /*  Push an element with a node that is not in the queue. Safe to call
+        from any number of threads.
+     */
+    assert(queue && node);
+    node->data = data;
+
+    // count the element before it can be drained, so that the depth never
+    // falls below the number of elements waiting
+    int depth =
+        atomic_fetch_add_explicit(&queue->depth, 1, memory_order_relaxed) + 1;
+    int max = atomic_load_explicit(&queue->max_depth, memory_order_relaxed);
+    while (depth > max && !atomic_compare_exchange_weak_explicit(
+                              &queue->max_depth, &max, depth,
+                              memory_order_relaxed, memory_order_relaxed)) {
+    }
+
+    // on failure, the exchange reloads the head into node->next
+    node->next = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    while (!atomic_compare_exchange_weak_explicit(&queue->head, &node->next,
+                                                  node, memory_order_release,
+                                                  memory_order_relaxed)) {
+    }
+}
+
+void **mpsc_drain(mpsc_t *queue, int *n) {
+    /*  Take every element pushed so far, in the order they were pushed.
+        Return them in an array owned by the queue, which is valid until the
+        next drain, and store their number in `n`. Must only be called by
+        the consumer.
+     */
+    assert(queue && n);
+    *n = 0;
+    if (!atomic_load_explicit(&queue->head, memory_order_relaxed)) {
+        return queue->batch;
+    }
+    mpsc_node_t *node =
+        atomic_exchange_explicit(&queue->head, NULL, memory_order_acquire);
+
+    // count the stack, then fill the batch from its end since the newest
+    // element is on top
+    int len = 0;
+    for (mpsc_node_t *curr = node; curr; curr = curr->next) {
+        len++;
+    }
+    if (len > queue->batch_size) {
+        while (queue->batch_size < len) {
+            queue->batch_size *= 2;
+        }
+        queue->batch =
+            (void **)realloc(queue->batch, queue->batch_size * sizeof(void *));
+        assert(queue->batch);
+    }
+    for (int i = len - 1; i >= 0; i--) {
+        mpsc_node_t *next = node->next;
+        queue->batch[i] = node->data;
+        node = next;
+    }
+    atomic_fetch_sub_explicit(&queue->depth, len, memory_order_relaxed);
+    queue->batches++;
+    queue->drained += len;
+    if (len > queue->max_batch) {
+        queue->max_batch = len;
+    }
+    *n = len;
+    return queue->batch;
+}
+
+int mpsc_depth(mpsc_t *queue) {
+    /*  Return the number of elements waiting to be drained. Producers count
+        an element just before pushing it, so it may briefly include
+        elements that are being pushed.
+     */
+    assert(queue);
+    return atomic_load_explicit(&queue->depth, memory_order_relaxed);
+}
@@ -0,0 +1,43 @@
+/* =============================================================================
+   mpsc.h
+
+   Lock-free multi-producer single-consumer queue that allows any data type
+   to be stored. Any number of threads may push while one thread drains.
+   The queue is intrusive: every element is pushed with a node owned by the
+   caller, typically embedded in the element, so pushing never allocates.
+
+   Author: David Sha
+============================================================================= */
+#ifndef _MPSC_H_
+#define _MPSC_H_
+
+/* #includes ================================================================ */
+#include <stdatomic.h>
+#include <stdint.h>
+
+/* structures =============================================================== */
+typedef struct mpsc_node mpsc_node_t;
+struct mpsc_node {
+    void *data;
+    mpsc_node_t *next;
+};
+
+typedef struct mpsc {
+    _Atomic(mpsc_node_t *) head;
+    atomic_int depth;
+    atomic_int max_depth;
+    void **batch;
+    int batch_size;
+    int max_batch;
+    uint64_t batches;
+    uint64_t drained;
+} mpsc_t;
+
+/* function prototypes ====================================================== */
+mpsc_t *create_mpsc();
+void free_mpsc(mpsc_t *queue, void (*free_data)(void *data));
+void mpsc_push(mpsc_t *queue, mpsc_node_t *node, void *data);
+void **mpsc_drain(mpsc_t *queue, int *n);
+int mpsc_depth(mpsc_t *queue);
+
+#endif
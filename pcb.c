@@ -14,19 +14,85 @@
 #include <assert.h>
 #include <string.h>
 #include <inttypes.h>
-#include <unistd.h>
 #include "pcb.h"
 
+static void read_field(pcb_t *pcb, char *field) {
+    /*  Parse an optional <key>=<value> field of a line of the input file.
+     */
+    char *value = strchr(field, '=');
+    if (!value) {
+        fprintf(stderr, "Error: Invalid field %s for process %s\n", field,
+                pcb->name);
+        exit(EXIT_FAILURE);
+    }
+    *value++ = '\0';
+    if (strcmp(field, "weight") == 0) {
+        long weight = strtol(value, NULL, 10);
+        if (weight <= 0) {
+            fprintf(stderr, "Error: Invalid weight %s for process %s\n",
+                    value, pcb->name);
+            exit(EXIT_FAILURE);
+        }
+        pcb->weight = (uint32_t)weight;
+    } else if (strcmp(field, "deadline") == 0) {
+        pcb->deadline = (uint32_t)strtoul(value, NULL, 10);
+    } else if (strcmp(field, "quantum") == 0) {
+        long quantum = strtol(value, NULL, 10);
+        if (quantum <= 0) {
+            fprintf(stderr, "Error: Invalid quantum %s for process %s\n",
+                    value, pcb->name);
+            exit(EXIT_FAILURE);
+        }
+        pcb->quantum = (uint32_t)quantum;
+    } else if (strcmp(field, "tenant") == 0) {
+        free(pcb->tenant);
+        pcb->tenant = strdup(value);
+        assert(pcb->tenant);
+    } else {
+        fprintf(stderr, "Error: Unknown field %s for process %s\n", field,
+                pcb->name);
+        exit(EXIT_FAILURE);
+    }
+}
+
 pcb_t *create_pcb(char *line) {
     /*  Given a line from the input file, parse it and return a pcb_t
         struct.
 
         The line should be in the format:
-        <arrival time> <name> <service time> <memory size>
+        <arrival time> <name> <service time> <memory size> [<key>=<value>]...
+
+        The optional fields are:
+        - weight=<weight>: share of the CPU relative to other processes under
+          the CFS scheduler (default DEFAULT_WEIGHT)
+        - tenant=<tenant>: tenant that owns the process for the fairness
+          report (default the name of the process)
+        - deadline=<time>: simulation time by which the process should
+          finish (default none)
+        - quantum=<quantum>: length of the cycles in which the process runs
+          (default the quantum given by the `-q` flag)
+        - command=<command>: shell command run instead of the process
+          executable, which must be the last field as it extends to the
+          end of the line (default none)
     */
     pcb_t *pcb;
     pcb = (pcb_t *)malloc(sizeof(*pcb));
     assert(pcb);
+    line[strcspn(line, "\r\n")] = '\0';
+
+    // the command may contain separators, so take it off the line first
+    pcb->command = NULL;
+    char *command = strstr(line, SEPARATOR COMMAND_FIELD);
+    if (command) {
+        *command = '\0';
+        command += strlen(SEPARATOR COMMAND_FIELD);
+        if (!*command) {
+            fprintf(stderr, "Error: Empty command in line %s\n", line);
+            exit(EXIT_FAILURE);
+        }
+        pcb->command = strdup(command);
+        assert(pcb->command);
+    }
     char *token = strtok(line, SEPARATOR);
     pcb->arrival_time = (uint32_t)strtoul(token, NULL, 10);
     token = strtok(NULL, SEPARATOR);
@@ -39,7 +105,37 @@ pcb_t *create_pcb(char *line) {
     pcb->remaining_time = pcb->service_time;
     token = strtok(NULL, SEPARATOR);
     pcb->memory_size = (uint16_t)strtoul(token, NULL, 10);
+    pcb->weight = DEFAULT_WEIGHT;
+    pcb->tenant = NULL;
+    pcb->vruntime = 0;
+    pcb->deadline = NO_DEADLINE;
+    pcb->quantum = 0;
+    pcb->predicted = 0;
+    pcb->priority = 0;
+    pcb->admission_time = 0;
+    pcb->deferred_since = NOT_DEFERRED;
+    pcb->deferred_time = 0;
+    while ((token = strtok(NULL, SEPARATOR))) {
+        read_field(pcb, token);
+    }
+    if (!pcb->tenant) {
+        pcb->tenant = strdup(pcb->name);
+        assert(pcb->tenant);
+    }
     pcb->memory = NULL;
+    pcb->resident_since = 0;
+    pcb->swap_done = 0;
+    pcb->pages = NULL;
+    pcb->page_seed = 0;
+    pcb->stall = 0;
+    pcb->page_references = 0;
+    pcb->page_faults = 0;
+    pcb->max_resident = 0;
+    pcb->submitted_ns = 0;
+    pcb->level = 0;
+    pcb->slice_used = 0;
+    pcb->seq = 0;
+    pcb->ready_node = NULL;
     pcb->process = NULL;
     pcb->state = NEW;
     pcb->termination_time = 0;
@@ -50,7 +146,12 @@ void free_pcb(void *data) {
     /*  Free a pcb_t struct.
      */
     pcb_t *pcb = (pcb_t *)data;
+    if (pcb->process) {
+        free_process(pcb->process);
+    }
     free(pcb->name);
+    free(pcb->tenant);
+    free(pcb->command);
     free(pcb);
 }
 
@@ -63,75 +164,10 @@ void print_pcb(void *data) {
 }
 
 process_t *initialise_process(pcb_t *pcb) {
-    /*  Create a process_t struct and fork a process to run the process
-        executable.
+    /*  Create a process_t struct for the process executable, or for the
+        command of the process if it has one. The real process is only
+        forked when it is first started.
      */
-    process_t *process;
-    process = (process_t *)malloc(sizeof(*process));
-    assert(process);
-    pcb->process = process;
-
-    // create pipes for communication with process
-    if (pipe(process->fd) == FAILED) {
-        perror("pipe");
-        exit(EXIT_FAILURE);
-    }
-    if (pipe(process->parent_fd) == FAILED) {
-        perror("pipe");
-        exit(EXIT_FAILURE);
-    }
-
-    // use fork to create a new process
-    switch (process->pid = fork()) {
-    case FAILED:
-        perror("fork");
-        exit(EXIT_FAILURE);
-
-    case 0: // child process
-        if (close(process->fd[1]) == FAILED) {
-            perror("close");
-            exit(EXIT_FAILURE);
-        }
-        if (close(process->parent_fd[0]) == FAILED) {
-            perror("close");
-            exit(EXIT_FAILURE);
-        }
-
-        // redirect stdin and stdout to pipes
-        if (dup2(process->fd[0], STDIN_FILENO) == FAILED) {
-            perror("dup2");
-            exit(EXIT_FAILURE);
-        }
-        if (dup2(process->parent_fd[1], STDOUT_FILENO) == FAILED) {
-            perror("dup2");
-            exit(EXIT_FAILURE);
-        }
-        if (close(process->fd[0]) == FAILED) {
-            perror("close");
-            exit(EXIT_FAILURE);
-        }
-        if (close(process->parent_fd[1]) == FAILED) {
-            perror("close");
-            exit(EXIT_FAILURE);
-        }
-
-        // execute process executable
-        char *cmd[] = {PROCESS_EXECUTABLE, pcb->name, NULL};
-        if (execvp(cmd[0], cmd) == FAILED) {
-            perror("execvp");
-            exit(EXIT_FAILURE);
-        }
-
-    default: // parent process
-        if (close(process->fd[0]) == FAILED) {
-            perror("close");
-            exit(EXIT_FAILURE);
-        }
-        if (close(process->parent_fd[1]) == FAILED) {
-            perror("close");
-            exit(EXIT_FAILURE);
-        }
-        // all other file descriptors close from `terminate_process()`
-    }
-    return process;
+    pcb->process = create_process(pcb->name, pcb->command, pcb->weight);
+    return pcb->process;
 }
@@ -13,6 +13,7 @@
 #include <stdint.h>
 #include "memorymanager.h"
 #include "process-api.h"
+#include "mpsc.h"
 
 /* structures =============================================================== */
 typedef struct process_control_block {
@@ -25,6 +26,31 @@ typedef struct process_control_block {
     uint16_t memory_size;
     block_t *memory;
     process_t *process;
+    int level;
+    uint32_t slice_used;
+    uint64_t seq;
+    uint32_t weight;
+    char *tenant;
+    uint64_t vruntime;
+    uint32_t deadline;
+    uint32_t quantum;
+    double predicted;
+    double priority;
+    uint32_t admission_time;
+    uint32_t deferred_since;
+    uint32_t deferred_time;
+    uint32_t resident_since;
+    uint64_t swap_done;
+    page_table_t *pages;
+    uint32_t page_seed;
+    uint32_t stall;
+    uint64_t page_references;
+    uint64_t page_faults;
+    uint32_t max_resident;
+    uint64_t submitted_ns;
+    char *command;
+    node_t *ready_node;
+    mpsc_node_t arrival_node;
 } pcb_t;
 
 /* function prototypes ====================================================== */
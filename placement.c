@@ -0,0 +1,238 @@
+/* =============================================================================
+   placement.c
+
+   The implementation of placement. The manager takes the first CPU it is
+   allowed to run on for itself, if there is more than one, so that its
+   cycles are not delayed by the processes it runs, and the other CPUs are
+   given to real processes by one of the following policies:
+   - float: processes may run on any of them, as chosen by the kernel
+   - spread: every process is pinned to the next of them in turn, taking
+     the nodes in turn, so that processes are spread over all nodes
+   - pack: every process is pinned to the same CPU, on the node of the
+     manager if possible, so that processes share its caches and memory
+
+   A pinned process also binds its memory to the node of its CPU, if the
+   kernel supports memory policies and there is more than one node. The
+   binding is made by the child with `set_mempolicy()` before it executes,
+   since `mbind()` only applies to memory that is already mapped.
+
+   Nodes and their CPUs are read from sysfs. Without sysfs, all CPUs are
+   taken to be on node 0.
+
+   Author: David Sha
+============================================================================= */
+#define _GNU_SOURCE // for sched_setaffinity() and cpu_set_t
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#include "config.h"
+#include "placement.h"
+
+#define PATH_LENGTH 64
+#define STAT_LENGTH 1024
+#define LONG_BITS (8 * sizeof(unsigned long))
+
+// spaces in /proc/<pid>/stat after the name, up to the last CPU it ran on
+#define PROCESSOR_FIELD 37
+
+static char *policy = NULL;
+static int manager_cpu = NO_CPU;
+
+// CPUs processes may run on, in the order they are assigned
+static int cpus[CPU_SETSIZE];
+static int n_cpus = 0;
+static int next_cpu = 0;
+static cpu_set_t child_set;
+
+static int node_of[CPU_SETSIZE];
+static int n_nodes = 1;
+static int bind_memory = FALSE;
+
+static void read_topology() {
+    /*  Read the node of every CPU from the CPU lists of the nodes, given
+        as ranges such as `0-3,8-11`.
+     */
+    for (int node = 0; node < PLACEMENT_MAX_NODES; node++) {
+        char path[PATH_LENGTH];
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist",
+                 node);
+        FILE *fp = fopen(path, "r");
+        if (!fp) {
+            continue;
+        }
+        int first, last, next;
+        while (fscanf(fp, "%d", &first) == 1) {
+            last = first;
+            next = fgetc(fp);
+            if (next == '-' && fscanf(fp, "%d", &last) == 1) {
+                next = fgetc(fp);
+            }
+            for (int cpu = first; cpu <= last && cpu < CPU_SETSIZE; cpu++) {
+                node_of[cpu] = node;
+            }
+            if (next != ',') {
+                break;
+            }
+        }
+        fclose(fp);
+        n_nodes = node + 1;
+    }
+}
+
+static void set_memory_policy(int mode, int node) {
+    /*  Set the memory policy of the calling process to the given node.
+        Failure is ignored, as memory binding is best effort.
+     */
+    unsigned long mask[PLACEMENT_MAX_NODES / LONG_BITS] = {0};
+    mask[node / LONG_BITS] |= 1UL << (node % LONG_BITS);
+    syscall(SYS_set_mempolicy, mode, mask, PLACEMENT_MAX_NODES + 1);
+}
+
+void open_placement(char *name) {
+    /*  Place the manager and the real processes spawned from now on by the
+        given policy.
+     */
+    policy = name;
+    read_topology();
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) == FAILED) {
+        perror("sched_getaffinity");
+        exit(EXIT_FAILURE);
+    }
+
+    // keep the first CPU for the manager, unless it is the only one
+    int n_allowed = CPU_COUNT(&allowed);
+    CPU_ZERO(&child_set);
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (!CPU_ISSET(cpu, &allowed)) {
+            continue;
+        }
+        if (manager_cpu == NO_CPU && n_allowed > 1) {
+            manager_cpu = cpu;
+            continue;
+        }
+        CPU_SET(cpu, &child_set);
+    }
+
+    // order the CPUs of processes so that consecutive ones are on
+    // different nodes for spread, and start on the manager's node for pack
+    int manager_node = manager_cpu == NO_CPU ? 0 : node_of[manager_cpu];
+    int rank[PLACEMENT_MAX_NODES] = {0};
+    for (int round = 0; n_cpus < CPU_COUNT(&child_set); round++) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            if (!CPU_ISSET(cpu, &child_set) || rank[node_of[cpu]] != round) {
+                continue;
+            }
+            rank[node_of[cpu]]++;
+            cpus[n_cpus++] = cpu;
+        }
+    }
+    if (strcmp(policy, PACK) == 0) {
+        for (int i = 0; i < n_cpus; i++) {
+            if (node_of[cpus[i]] == manager_node) {
+                cpus[0] = cpus[i];
+                break;
+            }
+        }
+    }
+
+    // memory policies may be unsupported by the kernel or not permitted
+    bind_memory = n_nodes > 1 &&
+                  syscall(SYS_get_mempolicy, NULL, NULL, 0, NULL, 0) == 0;
+    if (manager_cpu != NO_CPU) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(manager_cpu, &set);
+        if (sched_setaffinity(0, sizeof(set), &set) == FAILED) {
+            perror("sched_setaffinity");
+            exit(EXIT_FAILURE);
+        }
+        if (bind_memory) {
+            set_memory_policy(MPOL_PREFERRED, manager_node);
+        }
+    }
+}
+
+int is_placing() {
+    /*  Return whether processes are placed.
+     */
+    return policy != NULL;
+}
+
+int assign_cpu() {
+    /*  Return the CPU to pin a new process to, or NO_CPU if it floats.
+     */
+    assert(policy);
+    if (strcmp(policy, FLOAT) == 0) {
+        return NO_CPU;
+    }
+    if (strcmp(policy, PACK) == 0) {
+        return cpus[0];
+    }
+    return cpus[next_cpu++ % n_cpus];
+}
+
+void bind_child(int cpu) {
+    /*  Pin the calling child to a CPU and bind its memory to the node of
+        the CPU, or let it float over every CPU but the manager's if `cpu`
+        is NO_CPU. Called by a child before it executes.
+     */
+    cpu_set_t set = child_set;
+    if (cpu != NO_CPU) {
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+    }
+    if (sched_setaffinity(0, sizeof(set), &set) == FAILED) {
+        perror("sched_setaffinity");
+        exit(EXIT_FAILURE);
+    }
+    if (bind_memory && cpu != NO_CPU) {
+        set_memory_policy(MPOL_BIND, node_of[cpu]);
+    }
+}
+
+int cpu_node(int cpu) {
+    /*  Return the node of a CPU.
+     */
+    assert(cpu >= 0 && cpu < CPU_SETSIZE);
+    return node_of[cpu];
+}
+
+int current_cpu(pid_t pid) {
+    /*  Return the CPU a process last ran on, or NO_CPU if it has exited.
+     */
+    char path[PATH_LENGTH];
+    char stat[STAT_LENGTH];
+    snprintf(path, sizeof(path), "/proc/%d/stat", (int)pid);
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        return NO_CPU;
+    }
+    size_t len = fread(stat, 1, sizeof(stat) - 1, fp);
+    fclose(fp);
+    stat[len] = '\0';
+
+    // the name may contain spaces, so count fields after its last ')'
+    char *field = strrchr(stat, ')');
+    if (!field) {
+        return NO_CPU;
+    }
+    for (int i = 0; i < PROCESSOR_FIELD && field; i++) {
+        field = strchr(field + 1, ' ');
+    }
+    return field ? atoi(field + 1) : NO_CPU;
+}
+
+void print_placement_topology() {
+    /*  Print the policy, the CPU of the manager, the number of CPUs left to
+        processes and of nodes, and whether memory was bound to nodes.
+     */
+    printf("Placement %s %d %d %d %s\n", policy, manager_cpu, n_cpus, n_nodes,
+           bind_memory ? "membind" : "no-membind");
+}
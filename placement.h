@@ -0,0 +1,24 @@
+/* =============================================================================
+   placement.h
+
+   Placement of real processes on CPUs and NUMA nodes, and measurement of
+   how often they migrate between them.
+
+   Author: David Sha
+============================================================================= */
+#ifndef _PLACEMENT_H_
+#define _PLACEMENT_H_
+
+/* #includes ================================================================ */
+#include <sys/types.h>
+
+/* function prototypes ====================================================== */
+void open_placement(char *policy);
+int is_placing();
+int assign_cpu();
+void bind_child(int cpu);
+int cpu_node(int cpu);
+int current_cpu(pid_t pid);
+void print_placement_topology();
+
+#endif
@@ -0,0 +1,213 @@
+/* =============================================================================
+   predict.c
+
+   The implementation of service time prediction. A real process manager
+   does not know how long a process will run, so the SJF-EST scheduler runs
+   the process with the shortest predicted service time instead.
+
+   The prediction for a process is the exponential average of the service
+   times of previous processes with the same name, kept in a history table
+   that may be loaded from and saved to a file so that it persists across
+   runs. A process whose name has not been seen is predicted to run for the
+   exponential average of the service times of every process that has
+   finished so far.
+
+   Author: David Sha
+============================================================================= */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <inttypes.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "predict.h"
+#include "profile.h"
+
+void load_history(cycle_t *c, char *file) {
+    /*  Load the history table from a file with one `<name> <estimate>` per
+        line. A missing file is an empty table, as on the first run.
+     */
+    FILE *fp = fopen(file, "r");
+    if (!fp) {
+        return;
+    }
+    char name[256];
+    double estimate;
+    while (fscanf(fp, "%255s %lf", name, &estimate) == 2) {
+        find_history(c, name)->estimate = estimate;
+    }
+    fclose(fp);
+}
+
+void save_history(cycle_t *c, char *file) {
+    /*  Save the history table to a file. The table is written to a
+        temporary file first and then renamed.
+     */
+    char *temp = (char *)malloc(strlen(file) + 5);
+    assert(temp);
+    sprintf(temp, "%s.tmp", file);
+    FILE *fp = fopen(temp, "w");
+    if (!fp) {
+        perror(temp);
+        exit(EXIT_FAILURE);
+    }
+    for (node_t *curr = c->history->head; curr; curr = curr->next) {
+        history_t *history = (history_t *)curr->data;
+        fprintf(fp, "%s %.6f\n", history->name, history->estimate);
+    }
+    if (fclose(fp) == EOF) {
+        perror("fclose");
+        exit(EXIT_FAILURE);
+    }
+    if (rename(temp, file) == FAILED) {
+        perror("rename");
+        exit(EXIT_FAILURE);
+    }
+    free(temp);
+}
+
+void free_history(void *data) {
+    /*  Free a history_t struct.
+     */
+    history_t *history = (history_t *)data;
+    free(history->name);
+    free(history);
+}
+
+int cmp_history(void *a, void *b) {
+    /*  Order histories by name.
+     */
+    return strcmp(((history_t *)a)->name, ((history_t *)b)->name);
+}
+
+history_t *find_history(cycle_t *c, char *name) {
+    /*  Return the history of the given name, creating an empty one with an
+        estimate of 0 if it is new. The list keeps histories in the order
+        they were created, for the history file.
+     */
+    history_t key = {.name = name};
+    history_t *history = (history_t *)rbtree_find(c->history_tree, &key);
+    if (history) {
+        return history;
+    }
+    history = (history_t *)malloc(sizeof(*history));
+    assert(history);
+    history->name = strdup(name);
+    assert(history->name);
+    history->estimate = 0;
+    append(c->history, history);
+    rbtree_insert(c->history_tree, history);
+    return history;
+}
+
+double predict_service_time(cycle_t *c, pcb_t *pcb) {
+    /*  Predict the service time of a process from the history of its name,
+        or from every process that has finished if its name is new.
+     */
+    history_t key = {.name = pcb->name};
+    history_t *history = (history_t *)rbtree_find(c->history_tree, &key);
+    return history ? history->estimate : c->estimate;
+}
+
+void update_prediction(cycle_t *c, pcb_t *pcb) {
+    /*  Once a process has finished and its service time is known, fold it
+        into the exponential averages of its name and of every process.
+     */
+    double actual = pcb->service_time;
+    c->estimate = PREDICT_ALPHA * actual + (1 - PREDICT_ALPHA) * c->estimate;
+    history_t key = {.name = pcb->name};
+    history_t *history = (history_t *)rbtree_find(c->history_tree, &key);
+    if (history) {
+        history->estimate =
+            PREDICT_ALPHA * actual + (1 - PREDICT_ALPHA) * history->estimate;
+        return;
+    }
+    find_history(c, pcb->name)->estimate = actual;
+}
+
+static int oracle_turnaround(cycle_t *c, uint32_t *turnaround) {
+    /*  Run the same input with the oracle SJF scheduler, which knows every
+        service time, on a cycle of its own with emulated processes, and
+        set its turnaround time. Its transcript is discarded, and the
+        profile and the statistics of this run are left as they were.
+        Return whether there was an input file to run.
+     */
+    if (!c->args->file) {
+        return FALSE;
+    }
+    args_t args = *c->args;
+    args.scheduler = SJF;
+    args.usage = FALSE;
+    args.checkpoint = NULL;
+    args.restore = NULL;
+    args.history = NULL;
+    args.profile = NULL;
+    args.trace = NULL;
+    args.memory_series = NULL;
+    args.realtime = NULL;
+    list_t *pcbs = read_pcbs(args.file);
+    cycle_t *oracle = create_cycle(&args);
+    copy_list(pcbs, oracle->submitted_queue);
+    int total_processes = list_len(pcbs);
+
+    // discard the transcript of the oracle
+    fflush(stdout);
+    int stdout_fd = dup(STDOUT_FILENO);
+    int null_fd = open("/dev/null", O_WRONLY);
+    if (stdout_fd == FAILED || null_fd == FAILED ||
+        dup2(null_fd, STDOUT_FILENO) == FAILED) {
+        perror("dup2");
+        exit(EXIT_FAILURE);
+    }
+    close(null_fd);
+    profile_t saved = profile;
+    profile.enabled = FALSE;
+    emulate_processes(TRUE);
+
+    while (list_len(oracle->finished_queue) +
+               list_len(oracle->rejected_queue) <
+           total_processes) {
+        run_cycle(oracle);
+        oracle->cycles++;
+        oracle->simulation_time += oracle->quantum;
+    }
+    *turnaround = average_turnaround_time(oracle->finished_queue);
+
+    emulate_processes(FALSE);
+    profile = saved;
+    fflush(stdout);
+    if (dup2(stdout_fd, STDOUT_FILENO) == FAILED) {
+        perror("dup2");
+        exit(EXIT_FAILURE);
+    }
+    close(stdout_fd);
+    free_cycle(oracle);
+    free_list(pcbs, free_pcb);
+    return TRUE;
+}
+
+void print_prediction_statistics(cycle_t *c) {
+    /*  Print the mean absolute error of the predicted service times, and
+        the turnaround time of the oracle SJF scheduler on the same input
+        with how far the turnaround time of this run is above it.
+     */
+    double error = 0;
+    int n = 0;
+    for (node_t *curr = c->finished_queue->head; curr; curr = curr->next) {
+        pcb_t *pcb = (pcb_t *)curr->data;
+        double diff = pcb->predicted - pcb->service_time;
+        error += diff < 0 ? -diff : diff;
+        n++;
+    }
+    printf("Prediction error %.2f\n", n ? error / n : 0);
+
+    uint32_t oracle;
+    if (!oracle_turnaround(c, &oracle)) {
+        return;
+    }
+    uint32_t turnaround = average_turnaround_time(c->finished_queue);
+    printf("Oracle turnaround time %" PRIu32 "\nTurnaround gap %.2f%%\n",
+           oracle,
+           oracle ? 100.0 * ((double)turnaround - oracle) / oracle : 0);
+}
@@ -0,0 +1,32 @@
+/* =============================================================================
+   predict.h
+
+   Prediction of service times for the SJF-EST scheduler, which does not
+   know the service time of a process until it finishes, and comparison
+   with the oracle SJF scheduler that does.
+
+   Author: David Sha
+============================================================================= */
+#ifndef _PREDICT_H_
+#define _PREDICT_H_
+
+/* #includes ================================================================ */
+#include "main.h"
+
+/* structures =============================================================== */
+typedef struct history {
+    char *name;
+    double estimate;
+} history_t;
+
+/* function prototypes ====================================================== */
+void load_history(cycle_t *c, char *file);
+void save_history(cycle_t *c, char *file);
+void free_history(void *data);
+int cmp_history(void *a, void *b);
+history_t *find_history(cycle_t *c, char *name);
+double predict_service_time(cycle_t *c, pcb_t *pcb);
+void update_prediction(cycle_t *c, pcb_t *pcb);
+void print_prediction_statistics(cycle_t *c);
+
+#endif
@@ -4,33 +4,968 @@
    This file is used to interact with the ./process executable. It contains
    functions to send and receive messages to and from a process using pipes.
 
+   Real processes are spawned lazily, i.e. only when they are first started,
+   and at most `max_live` of them are alive at any one time. When the limit
+   is reached, the least recently run suspended process is evicted and later
+   re-spawned by replaying its message history, which leaves its final SHA
+   unchanged. The history is replayed in batches with the op-prefixed
+   messages of `--freeze`, and a re-spawned process without a cgroup is
+   then stopped and continued by signals it does not handle.
+
+   Processes are never waited on for their exit here. Instead they are
+   collected asynchronously by the reaper, which also records their real
+   resource usage.
+
+   With the io_uring backend, pipe reads and writes are queued instead of
+   being made straight away, and all the messages of a cycle are submitted
+   together by `flush_processes()`. Signals are still sent immediately and
+   before the message they belong to, which is safe because the process
+   executable blocks on its pipe until the message arrives. A batch is
+   flushed early whenever a result is needed straight away, e.g. the SHA
+   of a terminated process, or before signalling a process that has not
+   yet answered its previous message.
+
+   With the emulated backend, no real processes are used at all. The
+   state machine of the process executable is emulated by emulator.c,
+   which produces the same SHA.
+
+   A process with a command runs it with the shell instead of the process
+   executable, in a process group of its own so that signals also reach
+   the children of the shell. Commands are controlled by signals alone,
+   since they do not read messages, and are never evicted since they could
+   not be brought back to the same state. They still count toward
+   `max_live`, and evict a suspended executable to make room when they are
+   spawned, but like executables exceed the limit when every live process
+   is running or a command, so that every command runs. Their output and
+   errors go to a pipe that is spliced into a log file between cycles,
+   which moves the output within the kernel without copying it through the
+   manager. The SHA of a command is the SHA-256 of its log.
+
+   With cgroups (`-G`), every real process runs in a cgroup of its own,
+   which is frozen to suspend it and thawed to resume it instead of
+   signalling it. This stops the whole tree of a command, and needs no
+   wait for the process to stop. The process executable is then run with
+   `--freeze`, so that it reads every message without a signal, each
+   preceded by its op, and computes the same SHA. Control falls back to
+   signals if cgroups cannot be used.
+
+   With placement (`-C`), every real process is pinned to a CPU, and its
+   memory to the node of the CPU, by placement.c before it executes. The
+   CPU a process last ran on is sampled once per cycle while it runs, to
+   count how often it migrated, and how often to another node.
+
    Author: David Sha
 ============================================================================= */
+#define _GNU_SOURCE // for splice() and pipe2()
+
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
+#include <errno.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <sys/wait.h>
+#include <sys/resource.h>
 #include <signal.h>
 #include "config.h"
 #include "process-api.h"
+#include "reaper.h"
+#include "uring.h"
+#include "emulator.h"
+#include "profile.h"
+#include "trace.h"
+#include "sha256.h"
+#include "cgroup.h"
+#include "placement.h"
+
+// a pipe read or write waiting to be submitted in a batch
+typedef struct message {
+    process_t *process;
+    int fd;
+    int is_read;
+    int is_check;
+    char *buffer;
+    int length;
+    char bytes[BIG_ENDIAN_BYTES + 1];
+    char expected;
+} message_t;
+
+// live processes, least recently run first
+static list_t *live = NULL;
+static int live_count = 0;
+static int max_live = MAX_LIVE_PROCESSES;
+
+// io_uring backend, NULL when using the blocking backend
+static uring_t *ring = NULL;
+static message_t batch[URING_ENTRIES];
+static int batch_len = 0;
+
+// commands whose output is still to be moved to their logs
+static list_t *commands = NULL;
+
+// TRUE once splice() has failed on the file system of the logs
+static int copy_output = FALSE;
+
+// TRUE when using the emulated backend
+static int emulated = FALSE;
+
+// TRUE when real processes use the CPU while running, in real-time mode
+static int spinning = FALSE;
+
+// TRUE when new real processes are controlled through cgroups
+static int cgroups = FALSE;
+
+// TRUE when real processes are placed on CPUs
+static int placing = FALSE;
+
+// calls, total and maximum wall time in nanoseconds of each operation,
+// when the process API is timed
+static int timing = FALSE;
+static long op_calls[TERM + 1];
+static uint64_t op_total_ns[TERM + 1];
+static uint64_t op_max_ns[TERM + 1];
+
+// system calls made to control processes
+static long syscalls = 0;
+
+void configure_processes(int max, char *backend) {
+    /*  Set the maximum number of concurrently live child processes and the
+        backend used to send messages. Each live process holds two pipe
+        file descriptors in the manager, so the limit is lowered if it would
+        exceed the file descriptor limit. The io_uring backend falls back to
+        the blocking backend if io_uring is not available.
+     */
+    assert(max > 0);
+    emulated = strcmp(backend, EMULATED) == 0;
+    if (strcmp(backend, URING) == 0 && !ring) {
+        ring = create_uring(URING_ENTRIES);
+        if (!ring) {
+            fprintf(stderr, "Warning: io_uring is not available, using the "
+                            "blocking backend\n");
+        }
+    }
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 &&
+        limit.rlim_cur != RLIM_INFINITY) {
+        int fd_max = ((int)limit.rlim_cur - RESERVED_FDS) / 2;
+        if (fd_max < max) {
+            max = fd_max > 0 ? fd_max : 1;
+        }
+    }
+    max_live = max;
+    if (!live) {
+        live = create_empty_list();
+        commands = create_empty_list();
+    }
+    if (!emulated) {
+        init_reaper();
+    }
+}
+
+void emulate_processes(int on) {
+    /*  Emulate every process and stop timing the process API while `on`,
+        e.g. for the oracle run of predict.c, then restore the backend and
+        timing that were configured once off.
+     */
+    static int configured_emulated, configured_timing;
+    if (on) {
+        configured_emulated = emulated;
+        configured_timing = timing;
+        emulated = TRUE;
+        timing = FALSE;
+    } else {
+        emulated = configured_emulated;
+        timing = configured_timing;
+    }
+}
+
+void spin_processes() {
+    /*  Make real processes spawned from now on use the CPU while they run,
+        rather than sleep until their next signal.
+     */
+    spinning = TRUE;
+}
+
+void control_processes(char *root) {
+    /*  Control real processes through cgroups under the given cgroup v2
+        directory, or keep using signals if cgroups cannot be created there.
+     */
+    if (emulated) {
+        return;
+    }
+    cgroups = open_cgroups(root);
+    if (!cgroups) {
+        fprintf(stderr, "Warning: cannot create cgroups in %s, using "
+                        "signals\n",
+                root);
+    }
+}
+
+void time_processes() {
+    /*  Time every call to the process API, to report the latency of
+        suspending and resuming processes.
+     */
+    timing = TRUE;
+}
+
+void print_control_statistics() {
+    /*  Print whether real processes were controlled by cgroups, and if so
+        whether they were limited by the cpu controller, or by signals.
+        Then print the calls, mean and maximum wall time in microseconds
+        of suspending and of resuming a process.
+     */
+    printf("Control %s\n",
+           cgroups ? (has_cgroup_cpu() ? "cgroup cpu" : "cgroup") : "signals");
+    const char *names[] = {"Suspend", "Resume"};
+    op_t ops[] = {STOP, CONTINUE};
+    for (int i = 0; i < 2; i++) {
+        long calls = op_calls[ops[i]];
+        printf("%s latency %ld %.2f %.2f\n", names[i], calls,
+               calls ? op_total_ns[ops[i]] / 1e3 / calls : 0,
+               op_max_ns[ops[i]] / 1e3);
+    }
+}
+
+void place_processes(char *policy) {
+    /*  Place real processes on CPUs by the given policy. Ignored with the
+        emulated backend, which has no real processes.
+     */
+    if (emulated) {
+        return;
+    }
+    open_placement(policy);
+    placing = TRUE;
+}
+
+void sample_process(process_t *process) {
+    /*  Sample the CPU a running real process last ran on, counting a
+        migration if it moved since the last sample.
+     */
+    if (!placing || process->pid == NOT_SPAWNED) {
+        return;
+    }
+    int cpu = current_cpu(process->pid);
+    if (cpu == NO_CPU) {
+        return;
+    }
+    if (process->last_cpu != NO_CPU && cpu != process->last_cpu) {
+        process->usage.migrations++;
+        if (cpu_node(cpu) != cpu_node(process->last_cpu)) {
+            process->usage.cross_node_migrations++;
+        }
+    }
+    process->last_cpu = cpu;
+}
+
+void free_processes() {
+    /*  Free the list of live processes. Assumes all processes have
+        been terminated.
+     */
+    if (live) {
+        assert(live_count == 0);
+        free_list(live, NULL);
+        live = NULL;
+        assert(is_empty_list(commands));
+        free_list(commands, NULL);
+        commands = NULL;
+    }
+    free_reaper();
+    if (cgroups) {
+        close_cgroups();
+        cgroups = FALSE;
+    }
+    if (ring) {
+        free_uring(ring);
+        ring = NULL;
+    }
+}
+
+long count_syscalls() {
+    /*  Return the number of system calls made so far to control processes.
+     */
+    return syscalls;
+}
+
+process_t *create_process(char *name, char *command, uint32_t weight) {
+    /*  Create a process_t struct for the process executable that will be
+        run with the given name, or for the given command if it is not
+        NULL, with the weight of its cgroup. The real process is not
+        spawned until the process is first started, but is assigned the
+        CPU it will be pinned to now, so that processes are placed in the
+        order they were submitted.
+     */
+    process_t *process;
+    process = (process_t *)malloc(sizeof(*process));
+    assert(process);
+    process->pid = NOT_SPAWNED;
+    process->stopping = FALSE;
+    process->queued = 0;
+    process->fd[0] = process->fd[1] = FAILED;
+    process->parent_fd[0] = process->parent_fd[1] = FAILED;
+    process->name = name;
+    process->command = command;
+    process->output_fd = process->log_fd = FAILED;
+    process->command_node = NULL;
+    process->weight = weight;
+    process->cgroup = NULL;
+    process->framed = FALSE;
+    process->cpu = placing ? assign_cpu() : NO_CPU;
+    process->last_cpu = NO_CPU;
+    process->history = NULL;
+    process->history_len = 0;
+    process->history_size = 0;
+    process->live_node = NULL;
+    process->usage = (usage_t){0};
+    process->content = NULL;
+    process->content_index = 0;
+    return process;
+}
+
+void free_process(void *data) {
+    /*  Free a process_t struct. The process must have been terminated.
+     */
+    process_t *process = (process_t *)data;
+    assert(process->pid == NOT_SPAWNED);
+    if (process->log_fd != FAILED) {
+        close(process->log_fd);
+    }
+    if (process->cgroup) {
+        free_cgroup(process->cgroup);
+    }
+    emulate_free(process);
+    free(process->history);
+    free(process);
+}
+
+static void close_on_exec(int fd) {
+    /*  Mark a file descriptor to be closed on exec, so that other children
+        do not inherit the manager's ends of the pipes.
+     */
+    if (fcntl(fd, F_SETFD, FD_CLOEXEC) == FAILED) {
+        perror("fcntl");
+        exit(EXIT_FAILURE);
+    }
+}
+
+static void signal_process(process_t *process, int sig) {
+    /*  Send a signal to a process. Any batched messages for the process
+        are flushed first, as the process may not have set up its signal
+        handling until it has answered them.
+     */
+    if (process->queued) {
+        flush_processes();
+    }
+    if (kill(process->pid, sig) == FAILED) {
+        perror("kill");
+        exit(EXIT_FAILURE);
+    }
+    syscalls++;
+}
+
+static void make_room() {
+    /*  Evict the least recently run suspended process if the maximum
+        number of live processes has been reached. The limit is exceeded
+        if every live process is running or a command.
+     */
+    if (live_count < max_live) {
+        return;
+    }
+    for (node_t *curr = live->head; curr; curr = curr->next) {
+        process_t *process = (process_t *)curr->data;
+        assert(process->history_len > 0);
+        if (process->history[process->history_len - 1].op == STOP) {
+            evict_process(process);
+            return;
+        }
+    }
+}
+
+static void prepare_cgroup(process_t *process) {
+    /*  Create the cgroup of a process before it is first spawned, or thaw
+        the cgroup of an evicted process so that it is re-spawned running.
+        New processes are controlled by signals if it cannot be created.
+     */
+    if (!cgroups) {
+        return;
+    }
+    if (!process->cgroup) {
+        process->cgroup = create_cgroup(process->weight);
+        syscalls += 3; // mkdir and opening its files
+        if (!process->cgroup) {
+            perror("mkdir");
+            fprintf(stderr, "Warning: cannot create a cgroup, using signals "
+                            "for new processes\n");
+            cgroups = FALSE;
+            return;
+        }
+    }
+    syscalls += freeze_cgroup(process->cgroup, FALSE);
+}
+
+static void freeze_process(process_t *process, int frozen) {
+    /*  Freeze or thaw the cgroup of a process, or stop or continue a
+        re-spawned process without one by signals it does not handle. As
+        with signals, batched messages for the process are flushed first,
+        so that a frozen process is not left with a message it must answer.
+     */
+    if (!process->cgroup) {
+        signal_process(process, frozen ? SIGSTOP : SIGCONT);
+        return;
+    }
+    if (process->queued) {
+        flush_processes();
+    }
+    syscalls += freeze_cgroup(process->cgroup, frozen);
+}
+
+static void mark_used(process_t *process) {
+    /*  Move a live process to the back of the eviction order.
+     */
+    remove_node(live, process->live_node);
+    append(live, process);
+    process->live_node = live->foot;
+}
+
+void spawn_process(process_t *process) {
+    /*  Fork a process to run the process executable, using pipes for
+        communication with the process.
+     */
+    assert(process->pid == NOT_SPAWNED);
+    make_room();
+    prepare_cgroup(process);
+    if (process->cgroup) {
+        process->framed = TRUE;
+    }
+
+    // create pipes for communication with process
+    if (pipe(process->fd) == FAILED) {
+        perror("pipe");
+        exit(EXIT_FAILURE);
+    }
+    if (pipe(process->parent_fd) == FAILED) {
+        perror("pipe");
+        exit(EXIT_FAILURE);
+    }
+    close_on_exec(process->fd[1]);
+    close_on_exec(process->parent_fd[0]);
+    syscalls += 5; // pipe, pipe, fcntl, fcntl and fork
+
+    // use fork to create a new process
+    switch (process->pid = fork()) {
+    case FAILED:
+        perror("fork");
+        exit(EXIT_FAILURE);
+
+    case 0: // child process
+        if (close(process->fd[1]) == FAILED) {
+            perror("close");
+            exit(EXIT_FAILURE);
+        }
+        if (close(process->parent_fd[0]) == FAILED) {
+            perror("close");
+            exit(EXIT_FAILURE);
+        }
+
+        // redirect stdin and stdout to pipes
+        if (dup2(process->fd[0], STDIN_FILENO) == FAILED) {
+            perror("dup2");
+            exit(EXIT_FAILURE);
+        }
+        if (dup2(process->parent_fd[1], STDOUT_FILENO) == FAILED) {
+            perror("dup2");
+            exit(EXIT_FAILURE);
+        }
+        if (close(process->fd[0]) == FAILED) {
+            perror("close");
+            exit(EXIT_FAILURE);
+        }
+        if (close(process->parent_fd[1]) == FAILED) {
+            perror("close");
+            exit(EXIT_FAILURE);
+        }
+
+        // execute process executable in its cgroup, on its CPU
+        if (placing) {
+            bind_child(process->cpu);
+        }
+        char *cmd[5];
+        int argc = 0;
+        cmd[argc++] = PROCESS_EXECUTABLE;
+        if (spinning) {
+            cmd[argc++] = "--spin";
+        }
+        if (process->cgroup) {
+            enter_cgroup(process->cgroup);
+        }
+        if (process->framed) {
+            cmd[argc++] = "--freeze";
+        }
+        cmd[argc++] = process->name;
+        cmd[argc] = NULL;
+        if (execvp(cmd[0], cmd) == FAILED) {
+            perror("execvp");
+            exit(EXIT_FAILURE);
+        }
+
+    default: // parent process
+        if (close(process->fd[0]) == FAILED) {
+            perror("close");
+            exit(EXIT_FAILURE);
+        }
+        if (close(process->parent_fd[1]) == FAILED) {
+            perror("close");
+            exit(EXIT_FAILURE);
+        }
+        // all other file descriptors close from `terminate_process()`
+        // or `evict_process()`
+        syscalls += 2;
+    }
+    watch_process(process);
+
+    append(live, process);
+    process->live_node = live->foot;
+    live_count++;
+}
+
+static void open_log(process_t *process) {
+    /*  Open the log of a command, keeping the output of an earlier run if
+        the process was restored from a snapshot. The log is not opened for
+        appending, since splice() cannot write to such a file, and is also
+        opened for reading so that it can be hashed.
+     */
+    if (process->log_fd != FAILED) {
+        return;
+    }
+    size_t len = strlen(process->name) + strlen(COMMAND_LOG_SUFFIX) + 1;
+    char *path = (char *)malloc(len);
+    assert(path);
+    snprintf(path, len, "%s%s", process->name, COMMAND_LOG_SUFFIX);
+    int flags = O_RDWR | O_CREAT | O_CLOEXEC;
+    if (!process->usage.spawns) {
+        flags |= O_TRUNC;
+    }
+    process->log_fd = open(path, flags, 0644);
+    if (process->log_fd == FAILED) {
+        perror(path);
+        exit(EXIT_FAILURE);
+    }
+    if (lseek(process->log_fd, 0, SEEK_END) == FAILED) {
+        perror("lseek");
+        exit(EXIT_FAILURE);
+    }
+    syscalls += 2;
+    free(path);
+}
+
+static void spawn_command(process_t *process) {
+    /*  Fork a process to run the command of a process with the shell, in a
+        process group of its own and with its output going to a pipe.
+     */
+    assert(process->pid == NOT_SPAWNED);
+    open_log(process);
+    make_room();
+    prepare_cgroup(process);
+    int output[2];
+    if (pipe2(output, O_CLOEXEC) == FAILED) {
+        perror("pipe2");
+        exit(EXIT_FAILURE);
+    }
+    syscalls += 2; // pipe2 and fork
+
+    switch (process->pid = fork()) {
+    case FAILED:
+        perror("fork");
+        exit(EXIT_FAILURE);
+
+    case 0: // child process
+        if (setpgid(0, 0) == FAILED) {
+            perror("setpgid");
+            exit(EXIT_FAILURE);
+        }
+        if (process->cgroup) {
+            enter_cgroup(process->cgroup);
+        }
+        if (placing) {
+            bind_child(process->cpu);
+        }
+
+        // read from /dev/null, and write output and errors to the pipe
+        int null_fd = open("/dev/null", O_RDONLY);
+        if (null_fd == FAILED) {
+            perror("open");
+            exit(EXIT_FAILURE);
+        }
+        if (dup2(null_fd, STDIN_FILENO) == FAILED ||
+            dup2(output[1], STDOUT_FILENO) == FAILED ||
+            dup2(output[1], STDERR_FILENO) == FAILED) {
+            perror("dup2");
+            exit(EXIT_FAILURE);
+        }
+        execl(COMMAND_SHELL, COMMAND_SHELL, "-c", process->command,
+              (char *)NULL);
+        perror("execl");
+        exit(EXIT_FAILURE);
+
+    default: // parent process
+        // also set the process group here, so that it exists before the
+        // first signal whichever of the two runs first. The child may have
+        // already run the shell, in which case this fails harmlessly
+        setpgid(process->pid, process->pid);
+        if (close(output[1]) == FAILED) {
+            perror("close");
+            exit(EXIT_FAILURE);
+        }
+        if (fcntl(output[0], F_SETFL, O_NONBLOCK) == FAILED) {
+            perror("fcntl");
+            exit(EXIT_FAILURE);
+        }
+
+        // a larger pipe lets the command write more between cycles. The
+        // size may be capped by the system, in which case it is kept
+        fcntl(output[0], F_SETPIPE_SZ, COMMAND_PIPE_SIZE);
+        syscalls += 4;
+    }
+    process->output_fd = output[0];
+    watch_process(process);
+    append(commands, process);
+    process->command_node = commands->foot;
+    live_count++;
+}
+
+static void signal_command(process_t *process, int sig) {
+    /*  Send a signal to the process group of a command. The command may
+        have already exited on its own.
+     */
+    if (kill(-process->pid, sig) == FAILED && errno != ESRCH) {
+        perror("kill");
+        exit(EXIT_FAILURE);
+    }
+    syscalls++;
+}
+
+static ssize_t move_output(process_t *process) {
+    /*  Move output waiting in the pipe of a command to its log, and return
+        the number of bytes moved as read() would. Falls back to copying
+        through the manager if the file system of the log does not support
+        splice().
+     */
+    if (!copy_output) {
+        ssize_t n = splice(process->output_fd, NULL, process->log_fd, NULL,
+                           COMMAND_SPLICE_BYTES,
+                           SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        syscalls++;
+        if (n != FAILED || errno != EINVAL) {
+            return n;
+        }
+        copy_output = TRUE;
+    }
+    char buffer[COMMAND_SPLICE_BYTES];
+    ssize_t n = read(process->output_fd, buffer, sizeof(buffer));
+    syscalls++;
+    for (ssize_t done = 0; done < n;) {
+        ssize_t written = write(process->log_fd, buffer + done, n - done);
+        syscalls++;
+        if (written == FAILED) {
+            perror("write");
+            exit(EXIT_FAILURE);
+        }
+        done += written;
+    }
+    return n;
+}
+
+static void close_output(process_t *process) {
+    /*  Close the pipe of a command, whose output is no longer moved.
+     */
+    if (close(process->output_fd) == FAILED) {
+        perror("close");
+        exit(EXIT_FAILURE);
+    }
+    syscalls++;
+    process->output_fd = FAILED;
+    remove_node(commands, process->command_node);
+    process->command_node = NULL;
+}
+
+static int drain_command(process_t *process) {
+    /*  Move all output waiting in the pipe of a command to its log. Once
+        the command and all its children have closed their output, close
+        the pipe and return FALSE.
+     */
+    for (;;) {
+        ssize_t n = move_output(process);
+        if (n > 0) {
+            continue;
+        }
+        if (n == 0) {
+            break;
+        }
+        if (errno == EAGAIN) {
+            return TRUE;
+        }
+        if (errno != EINTR) {
+            perror("splice");
+            exit(EXIT_FAILURE);
+        }
+    }
+    close_output(process);
+    return FALSE;
+}
+
+void drain_processes() {
+    /*  Move the output of every command to its log, so that no command
+        blocks on a full pipe.
+     */
+    if (!commands) {
+        return;
+    }
+    node_t *curr = commands->head;
+    while (curr) {
+        node_t *next = curr->next;
+        drain_command((process_t *)curr->data);
+        curr = next;
+    }
+}
+
+static char *hash_log(process_t *process) {
+    /*  Return the SHA-256 of the log of a command as a string.
+     */
+    char *string = (char *)calloc(SHA256_LENGTH + 1, sizeof(char));
+    assert(string);
+    struct stat st;
+    if (fstat(process->log_fd, &st) == FAILED) {
+        perror("fstat");
+        exit(EXIT_FAILURE);
+    }
+    if (st.st_size == 0) {
+        sha256_hash(string, (const uint8_t *)"", 0);
+        return string;
+    }
+    uint8_t *content = (uint8_t *)mmap(NULL, st.st_size, PROT_READ,
+                                       MAP_PRIVATE, process->log_fd, 0);
+    if (content == MAP_FAILED) {
+        perror("mmap");
+        exit(EXIT_FAILURE);
+    }
+    sha256_hash(string, content, st.st_size);
+    munmap(content, st.st_size);
+    return string;
+}
+
+static char *terminate_command(process_t *process) {
+    /*  Terminate a command and its children, killing them if they have not
+        closed their output within `COMMAND_KILL_TIMEOUT` milliseconds, and
+        move the rest of their output to the log. Return the SHA of the log.
+        The command is collected by the reaper.
+     */
+    if (process->pid != NOT_SPAWNED) {
+        // a stopped command only handles SIGTERM once continued
+        signal_command(process, SIGTERM);
+        if (process->cgroup) {
+            freeze_process(process, FALSE);
+        } else {
+            signal_command(process, SIGCONT);
+        }
+        int killed = FALSE;
+        struct pollfd pfd = {.fd = process->output_fd, .events = POLLIN};
+        while (process->output_fd != FAILED && drain_command(process)) {
+            int n = poll(&pfd, 1, COMMAND_KILL_TIMEOUT);
+            syscalls++;
+            if (n == FAILED && errno != EINTR) {
+                perror("poll");
+                exit(EXIT_FAILURE);
+            }
+            if (n != 0) {
+                continue;
+            }
+
+            // a process outside the group may still hold the output, so
+            // give up on it once the group has been killed
+            if (killed) {
+                close_output(process);
+                break;
+            }
+            // killing the cgroup also kills processes that left the group
+            if (!process->cgroup || !kill_cgroup(process->cgroup)) {
+                signal_command(process, SIGKILL);
+            }
+            killed = TRUE;
+        }
+        process->pid = NOT_SPAWNED;
+        live_count--;
+    }
+    open_log(process);
+    char *string = hash_log(process);
+    close(process->log_fd);
+    process->log_fd = FAILED;
+    return string;
+}
+
+static void close_process(process_t *process) {
+    /*  Close the manager's ends of the pipes and forget the live process.
+     */
+    if (close(process->fd[1]) == FAILED) {
+        perror("close");
+        exit(EXIT_FAILURE);
+    }
+    if (close(process->parent_fd[0]) == FAILED) {
+        perror("close");
+        exit(EXIT_FAILURE);
+    }
+    process->fd[1] = process->parent_fd[0] = FAILED;
+    syscalls += 2;
+    remove_node(live, process->live_node);
+    process->live_node = NULL;
+    process->pid = NOT_SPAWNED;
+    process->stopping = FALSE;
+    live_count--;
+}
+
+void evict_process(process_t *process) {
+    /*  Kill a suspended process to free its pid and pipes. Its message
+        history is kept so that it can be re-spawned later. The killed
+        process is collected by the reaper.
+     */
+    assert(process->pid > 0);
+    flush_processes();
+    signal_process(process, SIGKILL);
+    close_process(process);
+}
+
+static void record(process_t *process, op_t op, char *simulation_time) {
+    /*  Append a message to the history of a process.
+     */
+    if (process->history_len == process->history_size) {
+        process->history_size =
+            process->history_size ? process->history_size * 2 : 4;
+        process->history = (record_t *)realloc(
+            process->history, process->history_size * sizeof(record_t));
+        assert(process->history);
+    }
+    record_t *r = &process->history[process->history_len++];
+    r->op = op;
+    memcpy(r->simulation_time, simulation_time, BIG_ENDIAN_BYTES);
+}
+
+static message_t *queue_message(process_t *process, int fd, int is_read) {
+    /*  Add a read or write to the current batch, flushing the batch first
+        if it is full.
+     */
+    if (batch_len == URING_ENTRIES) {
+        flush_processes();
+    }
+    message_t *message = &batch[batch_len++];
+    message->process = process;
+    process->queued++;
+    message->fd = fd;
+    message->is_read = is_read;
+    message->is_check = FALSE;
+    message->buffer = message->bytes;
+    return message;
+}
+
+static void finish_message(message_t *message, int done) {
+    /*  Complete a batched read or write of which `done` bytes were
+        transferred by io_uring, then check the response if needed.
+     */
+    while (done < message->length) {
+        ssize_t n;
+        if (message->is_read) {
+            n = read(message->fd, message->buffer + done,
+                     message->length - done);
+        } else {
+            n = write(message->fd, message->buffer + done,
+                      message->length - done);
+        }
+        syscalls++;
+        if (n == FAILED || n == 0) {
+            perror(message->is_read ? "read" : "write");
+            exit(EXIT_FAILURE);
+        }
+        done += n;
+    }
+
+    // check response is same as least significant bit of message
+    if (message->is_check && message->bytes[0] != message->expected) {
+        printf("Error: Big Endian ordering did not pass correctly.\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+void flush_processes() {
+    /*  Submit all batched reads and writes with a single system call and
+        wait for all of them to complete.
+     */
+    if (!ring || batch_len == 0) {
+        return;
+    }
+    for (int i = 0; i < batch_len; i++) {
+        message_t *message = &batch[i];
+        queue_uring(ring,
+                    message->is_read ? IORING_OP_READ : IORING_OP_WRITE,
+                    message->fd, message->buffer, message->length, i);
+    }
+    submit_uring(ring, batch_len);
+    syscalls++;
+
+    // reap the completions, waiting again if interrupted
+    int completed = 0;
+    uint64_t i;
+    int32_t res;
+    while (completed < batch_len) {
+        if (!reap_uring(ring, &i, &res)) {
+            submit_uring(ring, batch_len - completed);
+            syscalls++;
+            continue;
+        }
+        if (res < 0) {
+            errno = -res;
+            perror(batch[i].is_read ? "read" : "write");
+            exit(EXIT_FAILURE);
+        }
+        finish_message(&batch[i], res);
+        batch[i].process->queued--;
+        completed++;
+    }
+    batch_len = 0;
+}
 
 void send_message(process_t *process, char *message, int length) {
     /*  Send a message to a process.
      */
+    if (ring) {
+        assert(length <= (int)sizeof(batch[0].bytes));
+        message_t *queued = queue_message(process, process->fd[1], FALSE);
+        memcpy(queued->bytes, message, length);
+        queued->length = length;
+        return;
+    }
     if (write(process->fd[1], message, length) == FAILED) {
         perror("write");
         exit(EXIT_FAILURE);
     }
+    syscalls++;
 }
 
 void receive_message(process_t *process, char *message, int length) {
     /*  Receive a message from a process.
      */
+    if (ring) {
+        message_t *queued = queue_message(process, process->parent_fd[0], TRUE);
+        queued->buffer = message;
+        queued->length = length;
+        flush_processes();
+        return;
+    }
     if (read(process->parent_fd[0], message, length) == FAILED) {
         perror("read");
         exit(EXIT_FAILURE);
     }
+    syscalls++;
 }
 
 void check_process(process_t *process, char *simulation_time) {
@@ -38,6 +973,15 @@ void check_process(process_t *process, char *simulation_time) {
         and checking that the least significant bit of the message
         is the same as the output from the process executable.
      */
+    if (ring) {
+        // the check is made when the batch is flushed
+        message_t *queued = queue_message(process, process->parent_fd[0], TRUE);
+        queued->is_check = TRUE;
+        queued->length = 1;
+        queued->expected = simulation_time[BIG_ENDIAN_BYTES - 1];
+        return;
+    }
+
     char response[1] = {0};
     receive_message(process, response, 1);
 
@@ -48,94 +992,287 @@ void check_process(process_t *process, char *simulation_time) {
     }
 }
 
-void start_process(process_t *process, char *simulation_time) {
-    /*  Send the simulation time as a message to a process
-        to start the process.
+static void await_stop(process_t *process) {
+    /*  Wait for a process that was sent SIGTSTP to stop. This is deferred
+        until the next message to the process, so that suspending a process
+        does not block the cycle in which it was suspended.
+     */
+    if (!process->stopping) {
+        return;
+    }
 
-        Check that the process was started correctly by checking
-        that the least significant bit of the message is the same
-        as the output from the process executable.
+    // the process cannot stop until it has read the STOP message
+    flush_processes();
+    int wstatus;
+    do {
+        if (waitpid(process->pid, &wstatus, WUNTRACED) == FAILED) {
+            perror("waitpid");
+            exit(EXIT_FAILURE);
+        }
+        syscalls++;
+    } while (!WIFSTOPPED(wstatus));
+    process->stopping = FALSE;
+}
+
+static void send_op(process_t *process, op_t op, char *simulation_time) {
+    /*  Send the simulation time as a message, preceded by its op if the
+        process is controlled through its cgroup or was re-spawned.
      */
-    send_message(process, simulation_time, BIG_ENDIAN_BYTES);
+    if (!process->framed) {
+        send_message(process, simulation_time, BIG_ENDIAN_BYTES);
+        return;
+    }
+    char message[BIG_ENDIAN_BYTES + 1];
+    message[0] = (char)op;
+    memcpy(message + 1, simulation_time, BIG_ENDIAN_BYTES);
+    send_message(process, message, sizeof(message));
+}
+
+static void send_start(process_t *process, char *simulation_time) {
+    /*  Send a START message without recording it.
+     */
+    send_op(process, START, simulation_time);
 
     // check that the process was started correctly
     check_process(process, simulation_time);
 }
 
-void suspend_process(process_t *process, char *simulation_time) {
-    /*  Send a simulation time as a message to a process. Then
-        suspend the process by sending a SIGTSTP signal.
+static void send_suspend(process_t *process, char *simulation_time) {
+    /*  Signal the process to stop and send a STOP message, without
+        recording it. A process in a cgroup or re-spawned is frozen
+        instead, and reads the message once thawed.
      */
+    if (process->framed) {
+        send_op(process, STOP, simulation_time);
+        freeze_process(process, TRUE);
+        return;
+    }
+
+    // suspend process, the stop is awaited before the next message
+    signal_process(process, SIGTSTP);
+    process->stopping = TRUE;
     send_message(process, simulation_time, BIG_ENDIAN_BYTES);
+}
 
-    // suspend process
-    int wstatus;
-    if (kill(process->pid, SIGTSTP) == FAILED) {
-        perror("kill");
-        exit(EXIT_FAILURE);
+static void send_continue(process_t *process, char *simulation_time) {
+    /*  Send a CONTINUE message and resume the process, without
+        recording it.
+     */
+    // continue process
+    if (process->framed) {
+        freeze_process(process, FALSE);
+    } else {
+        await_stop(process);
+        signal_process(process, SIGCONT);
     }
-    do {
-        if (waitpid(process->pid, &wstatus, WUNTRACED) == FAILED) {
-            perror("waitpid");
+    send_op(process, CONTINUE, simulation_time);
+
+    // check that the process was continue correctly
+    check_process(process, simulation_time);
+}
+
+static void respawn_process(process_t *process) {
+    /*  Re-spawn an evicted process and replay its message history so that
+        it is in the same state as before it was evicted. The process is
+        run with `--freeze`, so that the history is written in batches of
+        `REPLAY_BATCH` messages, each preceded by its op, without a signal
+        per message. The responses to a batch are read and checked before
+        the next one is written, so that neither pipe fills up.
+     */
+    process->framed = TRUE;
+    spawn_process(process);
+    char message[REPLAY_BATCH * (BIG_ENDIAN_BYTES + 1)];
+    char expected[REPLAY_BATCH];
+    char response[REPLAY_BATCH];
+    int i = 0;
+    while (i < process->history_len) {
+        int length = 0, n_expected = 0;
+        for (int n = 0; n < REPLAY_BATCH && i < process->history_len;
+             n++, i++) {
+            record_t *r = &process->history[i];
+            message[length++] = (char)r->op;
+            memcpy(message + length, r->simulation_time, BIG_ENDIAN_BYTES);
+            length += BIG_ENDIAN_BYTES;
+            if (r->op != STOP) {
+                expected[n_expected++] =
+                    r->simulation_time[BIG_ENDIAN_BYTES - 1];
+            }
+        }
+        message_t batch_write = {.fd = process->fd[1],
+                                 .buffer = message,
+                                 .length = length};
+        finish_message(&batch_write, 0);
+        message_t batch_read = {.fd = process->parent_fd[0],
+                                .is_read = TRUE,
+                                .buffer = response,
+                                .length = n_expected};
+        finish_message(&batch_read, 0);
+
+        // check responses are same as least significant bits of messages
+        if (memcmp(response, expected, n_expected) != 0) {
+            printf("Error: Big Endian ordering did not pass correctly.\n");
             exit(EXIT_FAILURE);
         }
-    } while (!WIFSTOPPED(wstatus));
+    }
+
+    // a process evicted while suspended is suspended again
+    if (process->history_len > 0 &&
+        process->history[process->history_len - 1].op == STOP) {
+        freeze_process(process, TRUE);
+    }
 }
 
-void continue_process(process_t *process, char *simulation_time) {
-    /*  Send a simulation time as a message to a process. Then
-        resume/continue the process by sending a SIGCONT signal.
+static void ensure_live(process_t *process) {
+    /*  Re-spawn a process that was evicted or restored from a checkpoint,
+        or move a live process to the back of the eviction order.
+     */
+    if (process->pid == NOT_SPAWNED) {
+        respawn_process(process);
+    } else {
+        mark_used(process);
+    }
+}
 
-        Check that the process was continue correctly by checking
+static uint64_t api_start() {
+    /*  Start timing a call to the process API, if it is profiled or traced.
+     */
+    return profile.enabled || is_tracing() || timing ? profile_clock() : 0;
+}
+
+static void api_end(process_t *process, op_t op, char *simulation_time,
+                    uint64_t start) {
+    /*  Stop timing a call to the process API started by api_start().
+     */
+    if (profile.enabled || is_tracing() || timing) {
+        uint64_t end = profile_clock();
+        profile_end(PHASE_PROCESS_API, start);
+        trace_api(process->name, op, simulation_time, start, end);
+        op_calls[op]++;
+        op_total_ns[op] += end - start;
+        if (end - start > op_max_ns[op]) {
+            op_max_ns[op] = end - start;
+        }
+    }
+}
+
+void start_process(process_t *process, char *simulation_time) {
+    /*  Send the simulation time as a message to a process
+        to start the process, spawning it first.
+
+        Check that the process was started correctly by checking
         that the least significant bit of the message is the same
         as the output from the process executable.
      */
-    send_message(process, simulation_time, BIG_ENDIAN_BYTES);
+    uint64_t start = api_start();
+    if (emulated) {
+        emulate_start(process);
+        emulate_message(process, START, simulation_time);
+    } else if (process->command) {
+        spawn_command(process);
+    } else {
+        if (process->pid == NOT_SPAWNED) {
+            spawn_process(process);
+        }
+        record(process, START, simulation_time);
+        send_start(process, simulation_time);
+    }
+    api_end(process, START, simulation_time, start);
+}
 
-    // continue process
-    if (kill(process->pid, SIGCONT) == FAILED) {
-        perror("kill");
-        exit(EXIT_FAILURE);
+void suspend_process(process_t *process, char *simulation_time) {
+    /*  Suspend the process by sending a SIGTSTP signal. Then send a
+        simulation time as a message to the process.
+     */
+    uint64_t start = api_start();
+    if (emulated) {
+        emulate_message(process, STOP, simulation_time);
+    } else if (process->command) {
+        if (process->pid == NOT_SPAWNED) {
+            // a command restored from a snapshot is not running
+        } else if (process->cgroup) {
+            freeze_process(process, TRUE);
+        } else {
+            signal_command(process, SIGTSTP);
+        }
+    } else {
+        ensure_live(process);
+        record(process, STOP, simulation_time);
+        send_suspend(process, simulation_time);
     }
+    api_end(process, STOP, simulation_time, start);
+}
 
-    // check that the process was continue correctly
-    check_process(process, simulation_time);
+void continue_process(process_t *process, char *simulation_time) {
+    /*  Resume/continue the process by sending a SIGCONT signal. Then
+        send a simulation time as a message to the process. An evicted
+        process is re-spawned first.
+
+        Check that the process was continue correctly by checking
+        that the least significant bit of the message is the same
+        as the output from the process executable.
+     */
+    uint64_t start = api_start();
+    if (emulated) {
+        emulate_message(process, CONTINUE, simulation_time);
+    } else if (process->command) {
+        // a command restored from a snapshot runs again from the start
+        if (process->pid == NOT_SPAWNED) {
+            spawn_command(process);
+        } else if (process->cgroup) {
+            freeze_process(process, FALSE);
+        } else {
+            signal_command(process, SIGCONT);
+        }
+    } else {
+        ensure_live(process);
+        record(process, CONTINUE, simulation_time);
+        send_continue(process, simulation_time);
+    }
+    api_end(process, CONTINUE, simulation_time, start);
 }
 
 char *terminate_process(process_t *process, char *simulation_time) {
-    /*  Send a simulation time as a message to a process. Then
-        terminate the process by sending a SIGTERM signal.
+    /*  Terminate the process by sending a SIGTERM signal. Then send a
+        simulation time as a message to the process.
 
         Then read a 64 byte string from stdout of process executable
         and include in execution transcript.
 
-        Return the string and free the process.
+        Return the string. The process is collected by the reaper.
      */
-    send_message(process, simulation_time, BIG_ENDIAN_BYTES);
+    uint64_t start = api_start();
+    if (emulated) {
+        char *string = emulate_terminate(process, simulation_time);
+        api_end(process, TERM, simulation_time, start);
+        return string;
+    }
+    if (process->command) {
+        char *string = terminate_command(process);
+        api_end(process, TERM, simulation_time, start);
+        return string;
+    }
+    ensure_live(process);
 
     // terminate process
-    if (kill(process->pid, SIGTERM) == FAILED) {
-        perror("kill");
-        exit(EXIT_FAILURE);
+    if (process->framed) {
+        freeze_process(process, FALSE);
+    } else {
+        await_stop(process);
+        signal_process(process, SIGTERM);
     }
+    send_op(process, TERM, simulation_time);
 
     // read 64 byte string from stdout of process executable
     char *string = (char *)calloc(SHA256_LENGTH + 1, sizeof(char));
     assert(string);
     receive_message(process, string, SHA256_LENGTH);
 
-    // close pipes
-    if (close(process->fd[1]) == FAILED) {
-        perror("close");
-        exit(EXIT_FAILURE);
-    }
-    if (close(process->parent_fd[0]) == FAILED) {
-        perror("close");
-        exit(EXIT_FAILURE);
-    }
-
-    // free process
-    free(process);
+    // close pipes, the history is no longer needed
+    close_process(process);
+    free(process->history);
+    process->history = NULL;
+    process->history_len = process->history_size = 0;
 
+    api_end(process, TERM, simulation_time, start);
     return string;
 }
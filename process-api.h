@@ -2,7 +2,8 @@
    process-api.h
 
    The process struct is used to represent a child process when this program
-   is executed.
+   is executed, which runs either the process executable or the command of
+   the process.
 
    Author: David Sha
 ============================================================================= */
@@ -10,16 +11,82 @@
 #define _PROCESS_API_H_
 
 /* #includes ================================================================ */
+#include <stdint.h>
 #include <sys/types.h>
+#include "config.h"
+#include "linkedlist.h"
+#include "cgroup.h"
 
 /* structures =============================================================== */
+
+/*  Operations understood by the process executable, with the same values
+    as the `Op` enum in process.c.
+ */
+typedef enum { START = 0, STOP = 1, CONTINUE = 2, TERM = 3 } op_t;
+
+/*  A message that was sent to a process, kept so that an evicted process
+    can be re-spawned and brought back to the same state.
+ */
+typedef struct record {
+    op_t op;
+    char simulation_time[BIG_ENDIAN_BYTES];
+} record_t;
+
+/*  Real resource usage of a process, summed over every time it was spawned.
+ */
+typedef struct usage {
+    double cpu_time;
+    double elapsed_time;
+    long max_rss;
+    long voluntary_switches;
+    long involuntary_switches;
+    long migrations;
+    long cross_node_migrations;
+    int spawns;
+} usage_t;
+
 typedef struct process {
     pid_t pid;
+    int stopping;
+    int queued;
     int fd[2];
     int parent_fd[2];
+    char *name;
+    char *command;
+    int output_fd;
+    int log_fd;
+    node_t *command_node;
+    uint32_t weight;
+    cgroup_t *cgroup;
+    int framed;
+    int cpu;
+    int last_cpu;
+    record_t *history;
+    int history_len;
+    int history_size;
+    node_t *live_node;
+    usage_t usage;
+    uint8_t *content;
+    size_t content_index;
 } process_t;
 
 /* function prototypes ====================================================== */
+void configure_processes(int max_live, char *backend);
+void emulate_processes(int on);
+void spin_processes();
+void control_processes(char *root);
+void time_processes();
+void print_control_statistics();
+void place_processes(char *policy);
+void sample_process(process_t *process);
+void free_processes();
+long count_syscalls();
+void flush_processes();
+void drain_processes();
+process_t *create_process(char *name, char *command, uint32_t weight);
+void free_process(void *data);
+void spawn_process(process_t *process);
+void evict_process(process_t *process);
 void send_message(process_t *process, char *message, int length);
 void receive_message(process_t *process, char *message, int length);
 void check_process(process_t *process, char *simulation_time);
@@ -0,0 +1,70 @@
+/* =============================================================================
+   profile.h
+
+   Instrumentation of the cycle loop. The wall time of each phase of a cycle
+   and counts of memory allocations and list nodes visited are collected
+   when profiling is enabled, and dumped as JSON at exit.
+
+   Author: David Sha
+============================================================================= */
+#ifndef _PROFILE_H_
+#define _PROFILE_H_
+
+/* #includes ================================================================ */
+#include <stdint.h>
+
+/* structures =============================================================== */
+
+/*  Phases of a cycle. PHASE_PROCESS_API is the time spent in calls to the
+    process API, which is also part of the phase that made the call.
+ */
+typedef enum {
+    PHASE_TERMINATION,
+    PHASE_ARRIVAL,
+    PHASE_MEMORY,
+    PHASE_SCHEDULE,
+    PHASE_END_CYCLE,
+    PHASE_FLUSH,
+    PHASE_REAP,
+    PHASE_CHECKPOINT,
+    PHASE_PROCESS_API,
+    N_PHASES
+} phase_t;
+
+typedef struct profile {
+    int enabled;
+    uint64_t calls[N_PHASES];
+    uint64_t total_ns[N_PHASES];
+    uint64_t max_ns[N_PHASES];
+    // counted whether or not profiling is enabled, since an increment
+    // costs less than checking
+    uint64_t allocations;
+    uint64_t failed_allocations;
+    uint64_t frees;
+    uint64_t list_visits;
+} profile_t;
+
+extern profile_t profile;
+
+/* function prototypes ====================================================== */
+void enable_profile();
+uint64_t profile_clock();
+void profile_phase(phase_t phase, uint64_t start);
+void dump_profile(char *file, uint64_t cycles, long syscalls);
+
+/*  Start timing a phase, returning 0 without reading the clock when
+    profiling is disabled.
+ */
+static inline uint64_t profile_start() {
+    return profile.enabled ? profile_clock() : 0;
+}
+
+/*  Stop timing a phase started by profile_start().
+ */
+static inline void profile_end(phase_t phase, uint64_t start) {
+    if (profile.enabled) {
+        profile_phase(phase, start);
+    }
+}
+
+#endif
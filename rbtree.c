@@ -0,0 +1,208 @@
+/* =============================================================================
+   rbtree.c
+
+   Left-leaning red-black tree that allows any data type to be stored,
+   ordered by a given comparison function. The tree stays balanced, so
+   inserting an element or removing the smallest one takes O(log n) time.
+   Equal elements are inserted after the ones already in the tree.
+
+   Reference:
+   - Robert Sedgewick, "Left-leaning Red-Black Trees", 2008.
+
+   Author: David Sha
+============================================================================= */
+#include <assert.h>
+#include <stdlib.h>
+#include "config.h"
+#include "rbtree.h"
+
+rbtree_t *create_rbtree(int (*cmp)(void *, void *)) {
+    /*  Create an empty tree ordered by `cmp`, which returns a negative
+        number if the first element comes before the second.
+     */
+    rbtree_t *tree;
+    tree = (rbtree_t *)malloc(sizeof(*tree));
+    assert(tree);
+    tree->root = NULL;
+    tree->len = 0;
+    tree->cmp = cmp;
+    return tree;
+}
+
+static void free_nodes(rbnode_t *node, void (*free_data)(void *data)) {
+    /*  Free a subtree and, if a function pointer is given, its data.
+     */
+    if (!node) {
+        return;
+    }
+    free_nodes(node->left, free_data);
+    free_nodes(node->right, free_data);
+    if (free_data) {
+        free_data(node->data);
+    }
+    free(node);
+}
+
+void free_rbtree(rbtree_t *tree, void (*free_data)(void *data)) {
+    /*  Free the tree. Give a function pointer to free the data. If no
+        function pointer is given, the data will not be freed.
+     */
+    assert(tree);
+    free_nodes(tree->root, free_data);
+    free(tree);
+}
+
+int rbtree_len(rbtree_t *tree) {
+    /*  Return the number of elements in the tree.
+     */
+    assert(tree);
+    return tree->len;
+}
+
+static int is_red(rbnode_t *node) {
+    /*  Return whether a node is red. Empty nodes are black.
+     */
+    return node != NULL && node->red;
+}
+
+static rbnode_t *rotate_left(rbnode_t *node) {
+    /*  Make the right child of a node its parent.
+     */
+    rbnode_t *right = node->right;
+    node->right = right->left;
+    right->left = node;
+    right->red = node->red;
+    node->red = TRUE;
+    return right;
+}
+
+static rbnode_t *rotate_right(rbnode_t *node) {
+    /*  Make the left child of a node its parent.
+     */
+    rbnode_t *left = node->left;
+    node->left = left->right;
+    left->right = node;
+    left->red = node->red;
+    node->red = TRUE;
+    return left;
+}
+
+static void flip_colours(rbnode_t *node) {
+    /*  Flip the colours of a node and its children.
+     */
+    node->red = !node->red;
+    node->left->red = !node->left->red;
+    node->right->red = !node->right->red;
+}
+
+static rbnode_t *fix_up(rbnode_t *node) {
+    /*  Restore the left-leaning red-black invariants on the way up.
+     */
+    if (is_red(node->right) && !is_red(node->left)) {
+        node = rotate_left(node);
+    }
+    if (is_red(node->left) && is_red(node->left->left)) {
+        node = rotate_right(node);
+    }
+    if (is_red(node->left) && is_red(node->right)) {
+        flip_colours(node);
+    }
+    return node;
+}
+
+static rbnode_t *insert(rbtree_t *tree, rbnode_t *node, void *data) {
+    /*  Insert data into a subtree and return its new root.
+     */
+    if (!node) {
+        rbnode_t *new;
+        new = (rbnode_t *)malloc(sizeof(*new));
+        assert(new);
+        new->data = data;
+        new->left = new->right = NULL;
+        new->red = TRUE;
+        return new;
+    }
+    if (tree->cmp(data, node->data) < 0) {
+        node->left = insert(tree, node->left, data);
+    } else {
+        node->right = insert(tree, node->right, data);
+    }
+    return fix_up(node);
+}
+
+void rbtree_insert(rbtree_t *tree, void *data) {
+    /*  Insert an element into the tree.
+     */
+    assert(tree);
+    tree->root = insert(tree, tree->root, data);
+    tree->root->red = FALSE;
+    tree->len++;
+}
+
+void *rbtree_min(rbtree_t *tree) {
+    /*  Return the smallest element without removing it, or NULL if the
+        tree is empty.
+     */
+    assert(tree);
+    rbnode_t *node = tree->root;
+    if (!node) {
+        return NULL;
+    }
+    while (node->left) {
+        node = node->left;
+    }
+    return node->data;
+}
+
+void *rbtree_find(rbtree_t *tree, void *key) {
+    /*  Return an element equal to `key` by the comparison function, or NULL
+        if there is none.
+     */
+    assert(tree);
+    rbnode_t *node = tree->root;
+    while (node) {
+        int cmp = tree->cmp(key, node->data);
+        if (cmp == 0) {
+            return node->data;
+        }
+        node = cmp < 0 ? node->left : node->right;
+    }
+    return NULL;
+}
+
+static rbnode_t *delete_min(rbnode_t *node) {
+    /*  Remove the smallest node of a subtree and return its new root.
+     */
+    if (!node->left) {
+        free(node);
+        return NULL;
+    }
+    if (!is_red(node->left) && !is_red(node->left->left)) {
+        // borrow a red node from the right so that the left is not a
+        // 2-node
+        flip_colours(node);
+        if (is_red(node->right->left)) {
+            node->right = rotate_right(node->right);
+            node = rotate_left(node);
+            flip_colours(node);
+        }
+    }
+    node->left = delete_min(node->left);
+    return fix_up(node);
+}
+
+void *rbtree_pop_min(rbtree_t *tree) {
+    /*  Remove and return the smallest element, or NULL if the tree is
+        empty.
+     */
+    void *min = rbtree_min(tree);
+    if (!min) {
+        return NULL;
+    }
+    tree->root = delete_min(tree->root);
+    if (tree->root) {
+        tree->root->red = FALSE;
+    }
+    tree->len--;
+    return min;
+}
@@ -0,0 +1,36 @@
+/* =============================================================================
+   rbtree.h
+
+   Left-leaning red-black tree that allows any data type to be stored,
+   ordered by a given comparison function.
+
+   Author: David Sha
+============================================================================= */
+#ifndef _RBTREE_H_
+#define _RBTREE_H_
+
+/* structures =============================================================== */
+typedef struct rbnode rbnode_t;
+struct rbnode {
+    void *data;
+    rbnode_t *left;
+    rbnode_t *right;
+    int red;
+};
+
+typedef struct rbtree {
+    rbnode_t *root;
+    int len;
+    int (*cmp)(void *, void *);
+} rbtree_t;
+
+/* function prototypes ====================================================== */
+rbtree_t *create_rbtree(int (*cmp)(void *, void *));
+void free_rbtree(rbtree_t *tree, void (*free_data)(void *data));
+int rbtree_len(rbtree_t *tree);
+void rbtree_insert(rbtree_t *tree, void *data);
+void *rbtree_min(rbtree_t *tree);
+void *rbtree_find(rbtree_t *tree, void *key);
+void *rbtree_pop_min(rbtree_t *tree);
+
+#endif
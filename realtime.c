@@ -0,0 +1,160 @@
+/* =============================================================================
+   realtime.c
+
+   The implementation of real-time mode. Every cycle starts at the wall
+   time of its simulation time, measured from the start of the run, and
+   the manager sleeps on a timerfd until then. Meanwhile the process that
+   was dispatched runs for real, so a process that runs for a quantum uses
+   the CPU for the wall time of that quantum.
+
+   Deadlines are absolute, so lateness in one cycle is not carried into the
+   next. The jitter of a cycle is how late the manager woke for it. A cycle
+   overruns if the previous one took so long that its deadline had already
+   passed, in which case it starts straight away.
+
+   Author: David Sha
+============================================================================= */
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
+#include "config.h"
+#include "realtime.h"
+
+#define NS_PER_MS 1000000ULL
+#define NS_PER_SECOND 1000000000ULL
+
+static int timer_fd = FAILED;
+static uint64_t ns_per_second = 0;
+static uint64_t epoch = 0;
+
+// jitter of every cycle that was waited for, in microseconds
+static double *jitter = NULL;
+static int n_jitter = 0;
+static int jitter_size = 0;
+
+static int cycles = 0;
+static int overruns = 0;
+static uint64_t max_overrun = 0;
+static uint64_t total_overrun = 0;
+
+static uint64_t monotonic() {
+    /*  Return the monotonic wall time in nanoseconds.
+     */
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * NS_PER_SECOND + (uint64_t)now.tv_nsec;
+}
+
+void open_realtime(uint32_t ms_per_second) {
+    /*  Enable real-time mode, in which a simulated second lasts
+        `ms_per_second` milliseconds of wall time.
+     */
+    assert(ms_per_second > 0);
+    timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    if (timer_fd == FAILED) {
+        perror("timerfd_create");
+        exit(EXIT_FAILURE);
+    }
+    ns_per_second = ms_per_second * NS_PER_MS;
+}
+
+int is_realtime() {
+    /*  Return whether real-time mode is enabled.
+     */
+    return timer_fd != FAILED;
+}
+
+void start_realtime(uint32_t simulation_time) {
+    /*  Start the wall clock at the given simulation time, which is not 0
+        when resuming from a snapshot.
+     */
+    if (!is_realtime()) {
+        return;
+    }
+    epoch = monotonic() - simulation_time * ns_per_second;
+}
+
+void wait_realtime(uint32_t simulation_time) {
+    /*  Sleep until the wall time of the cycle at the given simulation time,
+        and record how late the wake up was or by how much the deadline was
+        overrun.
+     */
+    if (!is_realtime()) {
+        return;
+    }
+    uint64_t deadline = epoch + simulation_time * ns_per_second;
+    uint64_t now = monotonic();
+    cycles++;
+    if (now >= deadline) {
+        overruns++;
+        total_overrun += now - deadline;
+        if (now - deadline > max_overrun) {
+            max_overrun = now - deadline;
+        }
+        return;
+    }
+
+    struct itimerspec timer = {
+        .it_value = {.tv_sec = deadline / NS_PER_SECOND,
+                     .tv_nsec = deadline % NS_PER_SECOND}};
+    if (timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &timer, NULL) ==
+        FAILED) {
+        perror("timerfd_settime");
+        exit(EXIT_FAILURE);
+    }
+    uint64_t expirations;
+    while (read(timer_fd, &expirations, sizeof(expirations)) == FAILED) {
+        if (errno != EINTR) {
+            perror("read");
+            exit(EXIT_FAILURE);
+        }
+    }
+    now = monotonic();
+    if (n_jitter == jitter_size) {
+        jitter_size = jitter_size ? jitter_size * 2 : 64;
+        jitter = (double *)realloc(jitter, jitter_size * sizeof(*jitter));
+        assert(jitter);
+    }
+    jitter[n_jitter++] = (now - deadline) / 1e3;
+}
+
+static int cmp_jitter(const void *a, const void *b) {
+    /*  Compare two jitters for sorting in ascending order.
+     */
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+void print_realtime_statistics() {
+    /*  Print the 50th and 99th percentiles and maximum of the jitter in
+        microseconds, then the number of cycles that overran out of all
+        cycles, with the maximum and total overrun in milliseconds.
+     */
+    double p50 = 0, p99 = 0, max = 0;
+    if (n_jitter) {
+        qsort(jitter, n_jitter, sizeof(*jitter), cmp_jitter);
+        p50 = jitter[(n_jitter * 50 + 99) / 100 - 1];
+        p99 = jitter[(n_jitter * 99 + 99) / 100 - 1];
+        max = jitter[n_jitter - 1];
+    }
+    printf("Jitter %.1f %.1f %.1f\n", p50, p99, max);
+    printf("Overruns %d %d %.3f %.3f\n", overruns, cycles,
+           max_overrun / 1e6, total_overrun / 1e6);
+}
+
+void close_realtime() {
+    /*  Disable real-time mode and free its statistics.
+     */
+    if (!is_realtime()) {
+        return;
+    }
+    close(timer_fd);
+    timer_fd = FAILED;
+    free(jitter);
+    jitter = NULL;
+    n_jitter = jitter_size = 0;
+}
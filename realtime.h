@@ -0,0 +1,23 @@
+/* =============================================================================
+   realtime.h
+
+   Real-time mode, in which every simulated second lasts a fixed wall time,
+   so that real processes run for as long as they are scheduled.
+
+   Author: David Sha
+============================================================================= */
+#ifndef _REALTIME_H_
+#define _REALTIME_H_
+
+/* #includes ================================================================ */
+#include <stdint.h>
+
+/* function prototypes ====================================================== */
+void open_realtime(uint32_t ms_per_second);
+int is_realtime();
+void start_realtime(uint32_t simulation_time);
+void wait_realtime(uint32_t simulation_time);
+void print_realtime_statistics();
+void close_realtime();
+
+#endif
@@ -0,0 +1,209 @@
+/* =============================================================================
+   reaper.c
+
+   The implementation of the reaper. Every spawned process is watched with
+   a pidfd registered in an epoll instance, which becomes readable when the
+   process exits. If pidfds are not supported by the kernel, a signalfd for
+   SIGCHLD is registered instead. Exited processes are collected with
+   `wait4()` and their resource usage is added to their process_t struct,
+   along with the wall time from their spawn until they were collected.
+
+   Author: David Sha
+============================================================================= */
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/signalfd.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include "config.h"
+#include "linkedlist.h"
+#include "reaper.h"
+
+#ifndef SYS_pidfd_open
+#define SYS_pidfd_open 434
+#endif
+
+static int epoll_fd = FAILED;
+static int signal_fd = FAILED;
+static list_t *watches = NULL;
+
+static uint64_t monotonic() {
+    /*  Return the monotonic wall time in nanoseconds.
+     */
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+void init_reaper() {
+    /*  Create the epoll instance used to wait for processes to exit.
+     */
+    if (watches) {
+        return;
+    }
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd == FAILED) {
+        perror("epoll_create1");
+        exit(EXIT_FAILURE);
+    }
+    watches = create_empty_list();
+}
+
+void free_reaper() {
+    /*  Wait for all watched processes to exit and free the reaper.
+     */
+    if (!watches) {
+        return;
+    }
+    reap_processes(TRUE);
+    free_list(watches, NULL);
+    watches = NULL;
+    close(epoll_fd);
+    epoll_fd = FAILED;
+    if (signal_fd != FAILED) {
+        close(signal_fd);
+        signal_fd = FAILED;
+    }
+}
+
+static void watch_signals() {
+    /*  Fall back to a signalfd for SIGCHLD when pidfds are not available.
+        The signalfd is registered with a NULL pointer so that it can be
+        told apart from the pidfds.
+     */
+    if (signal_fd != FAILED) {
+        return;
+    }
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGCHLD);
+    if (sigprocmask(SIG_BLOCK, &mask, NULL) == FAILED) {
+        perror("sigprocmask");
+        exit(EXIT_FAILURE);
+    }
+    signal_fd = signalfd(FAILED, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (signal_fd == FAILED) {
+        perror("signalfd");
+        exit(EXIT_FAILURE);
+    }
+    struct epoll_event event = {.events = EPOLLIN, .data.ptr = NULL};
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, signal_fd, &event) == FAILED) {
+        perror("epoll_ctl");
+        exit(EXIT_FAILURE);
+    }
+}
+
+void watch_process(process_t *process) {
+    /*  Start watching a newly spawned process for its exit.
+     */
+    assert(watches && process->pid > 0);
+    watch_t *watch;
+    watch = (watch_t *)malloc(sizeof(*watch));
+    assert(watch);
+    watch->pid = process->pid;
+    watch->process = process;
+    watch->spawned_ns = monotonic();
+    watch->pidfd = (int)syscall(SYS_pidfd_open, process->pid, 0);
+    if (watch->pidfd == FAILED) {
+        if (errno != ENOSYS) {
+            perror("pidfd_open");
+            exit(EXIT_FAILURE);
+        }
+        watch_signals();
+    } else {
+        struct epoll_event event = {.events = EPOLLIN, .data.ptr = watch};
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, watch->pidfd, &event) ==
+            FAILED) {
+            perror("epoll_ctl");
+            exit(EXIT_FAILURE);
+        }
+    }
+    append(watches, watch);
+    watch->node = watches->foot;
+    process->usage.spawns++;
+}
+
+static int collect(watch_t *watch) {
+    /*  Collect a watched process if it has exited, adding its resource
+        usage to the process. Return TRUE if it was collected.
+     */
+    struct rusage rusage;
+    int wstatus;
+    pid_t pid = wait4(watch->pid, &wstatus, WNOHANG, &rusage);
+    if (pid == FAILED) {
+        perror("wait4");
+        exit(EXIT_FAILURE);
+    }
+    if (pid == 0) {
+        return FALSE;
+    }
+
+    usage_t *usage = &watch->process->usage;
+    usage->cpu_time += rusage.ru_utime.tv_sec + rusage.ru_stime.tv_sec +
+                       (rusage.ru_utime.tv_usec + rusage.ru_stime.tv_usec) /
+                           1e6;
+    if (rusage.ru_maxrss > usage->max_rss) {
+        usage->max_rss = rusage.ru_maxrss;
+    }
+    usage->elapsed_time += (monotonic() - watch->spawned_ns) / 1e9;
+    usage->voluntary_switches += rusage.ru_nvcsw;
+    usage->involuntary_switches += rusage.ru_nivcsw;
+
+    // closing the pidfd also removes it from the epoll instance
+    if (watch->pidfd != FAILED) {
+        close(watch->pidfd);
+    }
+    remove_node(watches, watch->node);
+    free(watch);
+    return TRUE;
+}
+
+int reap_processes(int block) {
+    /*  Collect all processes that have exited. If `block` is TRUE, wait
+        until every watched process has exited. Return the number of
+        processes collected.
+     */
+    struct epoll_event events[REAPER_EVENTS];
+    int reaped = 0;
+    if (!watches) {
+        return reaped;
+    }
+    while (!is_empty_list(watches)) {
+        int n = epoll_wait(epoll_fd, events, REAPER_EVENTS, block ? -1 : 0);
+        if (n == FAILED) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("epoll_wait");
+            exit(EXIT_FAILURE);
+        }
+        for (int i = 0; i < n; i++) {
+            if (events[i].data.ptr) {
+                reaped += collect((watch_t *)events[i].data.ptr);
+                continue;
+            }
+
+            // SIGCHLD: drain the signalfd and check every watched process
+            struct signalfd_siginfo info;
+            while (read(signal_fd, &info, sizeof(info)) == sizeof(info)) {
+            }
+            node_t *curr = watches->head;
+            while (curr) {
+                node_t *next = curr->next;
+                reaped += collect((watch_t *)curr->data);
+                curr = next;
+            }
+        }
+        if (!block) {
+            break;
+        }
+    }
+    return reaped;
+}
@@ -0,0 +1,33 @@
+/* =============================================================================
+   reaper.h
+
+   The reaper collects the exit status and resource usage of real processes
+   asynchronously, so that terminated and evicted processes do not remain
+   as zombies.
+
+   Author: David Sha
+============================================================================= */
+#ifndef _REAPER_H_
+#define _REAPER_H_
+
+/* #includes ================================================================ */
+#include <stdint.h>
+#include <sys/types.h>
+#include "process-api.h"
+
+/* structures =============================================================== */
+typedef struct watch {
+    pid_t pid;
+    int pidfd;
+    uint64_t spawned_ns;
+    process_t *process;
+    node_t *node;
+} watch_t;
+
+/* function prototypes ====================================================== */
+void init_reaper();
+void free_reaper();
+void watch_process(process_t *process);
+int reap_processes(int block);
+
+#endif
@@ -0,0 +1,915 @@
+/* =============================================================================
+   scheduler.c
+
+   The implementation of the schedulers other than SJF and RR.
+
+   Multilevel Feedback Queue (MLFQ): one FIFO queue per level, so that
+   choosing the next process takes O(1) time for a fixed number of levels.
+   New processes enter the top level. A process that has run for the quanta
+   of its level (in cycles) moves down a level, and processes at a higher
+   level preempt those at a lower one. Processes of the same level take
+   turns as in RR. Every boost period, all processes move back to the top
+   level.
+
+   Shortest Remaining Time First (SRTF): a min-heap of ready processes
+   ordered by remaining time, then arrival time, then name as in SJF. At
+   every cycle, the running process is preempted if a ready process has a
+   strictly shorter remaining time.
+
+   Completely Fair Scheduler (CFS): a red-black tree of ready processes
+   ordered by virtual runtime, which grows as a process runs at a rate
+   inversely proportional to its weight. The process with the smallest
+   virtual runtime runs next, so each process gets a share of the CPU
+   proportional to its weight. The time each tenant received is compared
+   with its weighted share of every cycle in the fairness report. Tenants
+   are found by name in a red-black tree, and their shares accrue lazily:
+   each cycle only adds its length over the total runnable weight to a
+   running sum, and a tenant is credited with its weight times the growth
+   of that sum whenever its weight changes or the report is printed.
+
+   Earliest Deadline First (EDF): a min-heap of ready processes ordered by
+   absolute deadline, then arrival time, then name. At every cycle, the
+   running process is preempted if a ready process has a strictly earlier
+   deadline. Processes without a deadline run last. A process is rejected on
+   arrival if it cannot finish by its deadline even if nothing else arrives.
+
+   Shortest Job First with estimates (SJF-EST): SJF on predicted service
+   times (see predict.c), for comparison with SJF, which knows them.
+
+   SJF with aging (`-a <rate>`): the priority of a waiting process is its
+   remaining time minus the aging rate times how long it has waited, so
+   long processes are not starved by a stream of short ones. Since every
+   waiting process ages at the same rate, ordering by remaining time plus
+   the aging rate times the time the process became ready gives the same
+   order, and does not change while a process waits. So a min-heap on that
+   key finds the process to run without rescanning the ready queue.
+
+   Author: David Sha
+============================================================================= */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <inttypes.h>
+#include "scheduler.h"
+#include "predict.h"
+
+static int cmp_remaining_time(void *a, void *b) {
+    /*  Order processes by remaining time, then by arrival time, then by
+        name, as the SJF scheduler does.
+     */
+    pcb_t *pa = (pcb_t *)a;
+    pcb_t *pb = (pcb_t *)b;
+    if (pa->remaining_time != pb->remaining_time) {
+        return pa->remaining_time < pb->remaining_time ? -1 : 1;
+    }
+    if (pa->arrival_time != pb->arrival_time) {
+        return pa->arrival_time < pb->arrival_time ? -1 : 1;
+    }
+    return strcmp(pa->name, pb->name);
+}
+
+static int cmp_deadline(void *a, void *b) {
+    /*  Order processes by deadline, then by arrival time, then by name.
+     */
+    pcb_t *pa = (pcb_t *)a;
+    pcb_t *pb = (pcb_t *)b;
+    if (pa->deadline != pb->deadline) {
+        return pa->deadline < pb->deadline ? -1 : 1;
+    }
+    if (pa->arrival_time != pb->arrival_time) {
+        return pa->arrival_time < pb->arrival_time ? -1 : 1;
+    }
+    return strcmp(pa->name, pb->name);
+}
+
+static int cmp_priority(void *a, void *b) {
+    /*  Order processes by aged priority, then by arrival time, then by name,
+        as the SJF scheduler does.
+     */
+    pcb_t *pa = (pcb_t *)a;
+    pcb_t *pb = (pcb_t *)b;
+    if (pa->priority != pb->priority) {
+        return pa->priority < pb->priority ? -1 : 1;
+    }
+    if (pa->arrival_time != pb->arrival_time) {
+        return pa->arrival_time < pb->arrival_time ? -1 : 1;
+    }
+    return strcmp(pa->name, pb->name);
+}
+
+static int cmp_lateness(const void *a, const void *b) {
+    /*  Compare two lateness values for sorting.
+     */
+    int64_t la = *(const int64_t *)a;
+    int64_t lb = *(const int64_t *)b;
+    return (la > lb) - (la < lb);
+}
+
+static uint32_t select_uint32(uint32_t *values, int n, int k) {
+    /*  Return the `k`th smallest of `n` values, counting from 0, by
+        quickselect, which reorders the values in expected O(n) time.
+     */
+    int lo = 0, hi = n - 1;
+    while (lo < hi) {
+        uint32_t pivot = values[lo + (hi - lo) / 2];
+        int i = lo, j = hi;
+        while (i <= j) {
+            while (values[i] < pivot) {
+                i++;
+            }
+            while (values[j] > pivot) {
+                j--;
+            }
+            if (i <= j) {
+                uint32_t value = values[i];
+                values[i++] = values[j];
+                values[j--] = value;
+            }
+        }
+
+        // values between j and i are all equal to the pivot
+        if (k <= j) {
+            hi = j;
+        } else if (k >= i) {
+            lo = i;
+        } else {
+            return pivot;
+        }
+    }
+    return values[k];
+}
+
+static int cmp_vruntime(void *a, void *b) {
+    /*  Order processes by virtual runtime, then by the order in which they
+        became ready.
+     */
+    pcb_t *pa = (pcb_t *)a;
+    pcb_t *pb = (pcb_t *)b;
+    if (pa->vruntime != pb->vruntime) {
+        return pa->vruntime < pb->vruntime ? -1 : 1;
+    }
+    return (pa->seq > pb->seq) - (pa->seq < pb->seq);
+}
+
+static int cmp_tenant(void *a, void *b) {
+    /*  Order tenants by name.
+     */
+    return strcmp(((tenant_t *)a)->name, ((tenant_t *)b)->name);
+}
+
+static void free_tenant(void *data) {
+    /*  Free a tenant_t struct.
+     */
+    tenant_t *tenant = (tenant_t *)data;
+    free(tenant->name);
+    free(tenant);
+}
+
+tenant_t *find_tenant(cycle_t *c, char *name) {
+    /*  Return the tenant with the given name, creating it if it is new.
+        The list keeps tenants in the order they were created, for the
+        fairness report.
+     */
+    tenant_t key = {.name = name};
+    tenant_t *tenant = (tenant_t *)rbtree_find(c->tenant_tree, &key);
+    if (tenant) {
+        return tenant;
+    }
+    tenant = (tenant_t *)calloc(1, sizeof(*tenant));
+    assert(tenant);
+    tenant->name = strdup(name);
+    assert(tenant->name);
+    tenant->share_mark = c->tenant_share;
+    append(c->tenants, tenant);
+    rbtree_insert(c->tenant_tree, tenant);
+    return tenant;
+}
+
+static void settle_tenant(cycle_t *c, tenant_t *tenant) {
+    /*  Credit a tenant with its share of every cycle since it was last
+        settled, which must be done before its runnable weight changes.
+     */
+    tenant->entitled +=
+        tenant->runnable_weight * (c->tenant_share - tenant->share_mark);
+    tenant->share_mark = c->tenant_share;
+}
+
+static void set_runnable_weight(cycle_t *c, tenant_t *tenant,
+                                uint64_t weight) {
+    /*  Change the runnable weight of a tenant, and the total with it.
+     */
+    settle_tenant(c, tenant);
+    c->tenant_weight += weight - tenant->runnable_weight;
+    tenant->runnable_weight = weight;
+}
+
+void settle_tenants(cycle_t *c) {
+    /*  Credit every tenant with its share of every cycle so far.
+     */
+    for (node_t *curr = c->tenants->head; curr; curr = curr->next) {
+        settle_tenant(c, (tenant_t *)curr->data);
+    }
+}
+
+static void parse_quanta(cycle_t *c, const char *quanta) {
+    /*  Parse a comma separated list of per-level quanta, in cycles, which
+        also gives the number of levels.
+     */
+    char *copy = strdup(quanta);
+    assert(copy);
+    c->n_levels = 0;
+    c->level_quanta = NULL;
+    for (char *token = strtok(copy, ","); token; token = strtok(NULL, ",")) {
+        long value = strtol(token, NULL, 10);
+        if (value <= 0) {
+            printf("Invalid argument for flag -L. Must be a comma separated "
+                   "list of positive integers\n");
+            exit(EXIT_FAILURE);
+        }
+        c->level_quanta = (uint32_t *)realloc(
+            c->level_quanta, (c->n_levels + 1) * sizeof(uint32_t));
+        assert(c->level_quanta);
+        c->level_quanta[c->n_levels++] = (uint32_t)value;
+    }
+    free(copy);
+    if (c->n_levels == 0) {
+        printf("Invalid argument for flag -L. Must be a comma separated "
+               "list of positive integers\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+void init_scheduler(cycle_t *c) {
+    /*  Create the structures used by the scheduler of the cycle.
+     */
+    c->levels = NULL;
+    c->n_levels = 0;
+    c->level_quanta = NULL;
+    c->boost_period = 0;
+    c->next_boost = 0;
+    c->ready_seq = 0;
+    c->ready_heap = NULL;
+    c->preemptions = 0;
+    c->vruntime_tree = NULL;
+    c->min_vruntime = 0;
+    c->tenants = create_empty_list();
+    c->tenant_tree = create_rbtree(cmp_tenant);
+    c->tenant_weight = 0;
+    c->tenant_share = 0;
+    c->history = create_empty_list();
+    c->history_tree = create_rbtree(cmp_history);
+    c->estimate = PREDICT_INITIAL_ESTIMATE;
+    c->adaptive_remaining = NULL;
+    c->adaptive_size = 0;
+    if (strcmp(c->args->scheduler, SJF_EST) == 0 && c->args->history) {
+        load_history(c, c->args->history);
+    }
+    if (strcmp(c->args->scheduler, CFS) == 0) {
+        c->vruntime_tree = create_rbtree(cmp_vruntime);
+    }
+    if (strcmp(c->args->scheduler, SRTF) == 0) {
+        c->ready_heap = create_heap(cmp_remaining_time);
+    } else if (strcmp(c->args->scheduler, EDF) == 0) {
+        c->ready_heap = create_heap(cmp_deadline);
+    } else if (strcmp(c->args->scheduler, SJF) == 0 && c->args->aging) {
+        c->ready_heap = create_heap(cmp_priority);
+    }
+    c->aging_rate = c->args->aging ? atof(c->args->aging) : 0;
+    if (c->aging_rate < 0) {
+        printf("Invalid argument for flag -a. Must be a non-negative "
+               "number\n");
+        exit(EXIT_FAILURE);
+    }
+    if (strcmp(c->args->scheduler, MLFQ) == 0) {
+        parse_quanta(c, c->args->levels ? c->args->levels : MLFQ_QUANTA);
+        c->levels = (list_t **)malloc(c->n_levels * sizeof(list_t *));
+        assert(c->levels);
+        for (int i = 0; i < c->n_levels; i++) {
+            c->levels[i] = create_empty_list();
+        }
+        c->boost_period = c->args->boost
+                              ? (uint32_t)strtoul(c->args->boost, NULL, 10)
+                              : MLFQ_BOOST_PERIOD;
+        c->next_boost = c->boost_period;
+    }
+}
+
+void free_scheduler(cycle_t *c) {
+    /*  Free the structures used by the scheduler of the cycle.
+     */
+    for (int i = 0; i < c->n_levels && c->levels; i++) {
+        free_list(c->levels[i], NULL);
+    }
+    free(c->levels);
+    free(c->level_quanta);
+    if (c->ready_heap) {
+        free_heap(c->ready_heap, NULL);
+    }
+    if (c->vruntime_tree) {
+        free_rbtree(c->vruntime_tree, NULL);
+    }
+    free_rbtree(c->tenant_tree, NULL);
+    free_list(c->tenants, free_tenant);
+    if (strcmp(c->args->scheduler, SJF_EST) == 0 && c->args->history) {
+        save_history(c, c->args->history);
+    }
+    free(c->adaptive_remaining);
+    free_rbtree(c->history_tree, NULL);
+    free_list(c->history, free_history);
+}
+
+void enqueue_ready(cycle_t *c, pcb_t *pcb) {
+    /*  Add a process that has just been added to the ready queue to the
+        structure of the scheduler.
+     */
+    pcb->seq = c->ready_seq++;
+    pcb->priority = pcb->remaining_time +
+                    c->aging_rate * (double)c->simulation_time;
+    if (c->levels) {
+        append(c->levels[pcb->level], pcb);
+    }
+    if (c->ready_heap) {
+        heap_push(c->ready_heap, pcb);
+    }
+    if (c->vruntime_tree) {
+        if (pcb->state == READY) {
+            // a new process starts at the smallest virtual runtime so that
+            // it neither starves the others nor is starved
+            tenant_t *tenant = find_tenant(c, pcb->tenant);
+            tenant->processes++;
+            set_runnable_weight(c, tenant,
+                                tenant->runnable_weight + pcb->weight);
+            if (pcb->vruntime < c->min_vruntime) {
+                pcb->vruntime = c->min_vruntime;
+            }
+        }
+        rbtree_insert(c->vruntime_tree, pcb);
+    }
+}
+
+static uint32_t round_up(cycle_t *c, uint32_t time) {
+    /*  Round a running time up to whole cycles, since processes only finish
+        at the end of a cycle.
+     */
+    return (time + c->quantum - 1) / c->quantum * c->quantum;
+}
+
+static uint32_t earliest_finish(cycle_t *c, pcb_t *pcb) {
+    /*  Return the earliest time an arriving process can finish under EDF if
+        no other process arrives. Every admitted process with an earlier or
+        equal deadline runs first, and under best-fit a process that does
+        not fit in any free block cannot start before the admitted process
+        with the least remaining time finishes.
+     */
+    list_t *queues[] = {c->input_queue, c->ready_queue, c->running_queue};
+    uint64_t work = 0;
+    uint32_t wait = UINT32_MAX;
+    for (int i = 0; i < 3; i++) {
+        for (node_t *curr = queues[i]->head; curr; curr = curr->next) {
+            pcb_t *other = (pcb_t *)curr->data;
+            uint32_t remaining = round_up(c, other->remaining_time);
+            if (other->deadline <= pcb->deadline) {
+                work += remaining;
+            }
+            if (other->memory && remaining < wait) {
+                wait = remaining;
+            }
+        }
+    }
+    if (strcmp(c->args->memory, BESTFIT) == 0 &&
+        mm_largest_free(c->memory) < pcb->memory_size && wait > work &&
+        wait != UINT32_MAX) {
+        work = wait;
+    }
+    uint64_t finish =
+        c->simulation_time + work + round_up(c, pcb->service_time);
+    return finish > UINT32_MAX ? UINT32_MAX : (uint32_t)finish;
+}
+
+int admit_process(cycle_t *c, pcb_t *pcb) {
+    /*  Decide whether an arriving process is admitted. Under EDF, a process
+        that cannot finish by its deadline is rejected, moved from the
+        submitted queue to the rejected queue and never run. Return whether
+        the process was admitted.
+     */
+    if (strcmp(c->args->scheduler, EDF) != 0 || pcb->deadline == NO_DEADLINE) {
+        return TRUE;
+    }
+    uint32_t finish = earliest_finish(c, pcb);
+    if (finish <= pcb->deadline) {
+        return TRUE;
+    }
+    printf("%" PRIu32 ",REJECTED,process_name=%s,deadline=%" PRIu32
+           ",earliest_finish=%" PRIu32 "\n",
+           c->simulation_time, pcb->name, pcb->deadline, finish);
+    move_data(pcb, c->submitted_queue, c->rejected_queue);
+    pcb->state = TERMINATED;
+    return FALSE;
+}
+
+void finish_scheduled(cycle_t *c, pcb_t *pcb) {
+    /*  Remove a process that has just finished from the structure of the
+        scheduler.
+     */
+    if (c->vruntime_tree) {
+        tenant_t *tenant = find_tenant(c, pcb->tenant);
+        set_runnable_weight(c, tenant,
+                            tenant->runnable_weight - pcb->weight);
+    }
+    if (strcmp(c->args->scheduler, SJF_EST) == 0) {
+        update_prediction(c, pcb);
+    }
+}
+
+static int cmp_seq(const void *a, const void *b) {
+    /*  Compare processes by the order in which they became ready.
+     */
+    pcb_t *pa = *(pcb_t **)a;
+    pcb_t *pb = *(pcb_t **)b;
+    return (pa->seq > pb->seq) - (pa->seq < pb->seq);
+}
+
+void restore_scheduler(cycle_t *c) {
+    /*  Rebuild the structure of the scheduler from the ready queue after
+        restoring a checkpoint, in the order processes became ready, and
+        the total runnable weight of the tenants.
+     */
+    for (node_t *curr = c->tenants->head; curr; curr = curr->next) {
+        c->tenant_weight += ((tenant_t *)curr->data)->runnable_weight;
+    }
+    int n = list_len(c->ready_queue);
+    if (n == 0) {
+        return;
+    }
+    pcb_t **ready = (pcb_t **)malloc(n * sizeof(pcb_t *));
+    assert(ready);
+    int i = 0;
+    for (node_t *curr = c->ready_queue->head; curr; curr = curr->next) {
+        ready[i++] = (pcb_t *)curr->data;
+    }
+    qsort(ready, n, sizeof(pcb_t *), cmp_seq);
+    for (i = 0; i < n && c->levels; i++) {
+        append(c->levels[ready[i]->level], ready[i]);
+    }
+    for (i = 0; i < n && c->ready_heap; i++) {
+        heap_push(c->ready_heap, ready[i]);
+    }
+    for (i = 0; i < n && c->vruntime_tree; i++) {
+        rbtree_insert(c->vruntime_tree, ready[i]);
+    }
+    free(ready);
+}
+
+void dispatch_process(cycle_t *c, pcb_t *pcb) {
+    /*  Move a process from the ready queue to the running queue, and start
+        or continue its real process.
+     */
+    if (DEBUG) {
+        printf("ACTION: Adding process %s to running queue\n", pcb->name);
+    }
+    printf("%" PRIu32 ",RUNNING,process_name=%s,remaining_time=%" PRIu32 "\n",
+           c->simulation_time, pcb->name, pcb->remaining_time);
+    c->context_switches++;
+    move_from_ready(c, pcb, c->running_queue);
+
+    // task4: start process or resume process
+    big_endian(c->simulation_time, c->big_endian);
+    if (pcb->state == READY) {
+        start_process(pcb->process, c->big_endian);
+    } else if (pcb->state == SUSPENDED) {
+        continue_process(pcb->process, c->big_endian);
+    } else {
+        fprintf(stderr,
+                "ERROR: Process %s is in an invalid state for "
+                "running\n",
+                pcb->name);
+        exit(EXIT_FAILURE);
+    }
+    pcb->state = RUNNING;
+}
+
+void preempt_process(cycle_t *c, pcb_t *pcb) {
+    /*  Move the running process back to the ready queue and suspend its
+        real process.
+     */
+    if (DEBUG) {
+        printf("ACTION: Suspending process %s\n", pcb->name);
+    }
+    move_to_ready(c, pcb, c->running_queue);
+    pcb->state = SUSPENDED;
+    c->preemptions++;
+    enqueue_ready(c, pcb);
+
+    // task4: suspend process
+    big_endian(c->simulation_time, c->big_endian);
+    suspend_process(pcb->process, c->big_endian);
+}
+
+void resume_running(cycle_t *c) {
+    /*  Let the currently running process, if any, continue to run.
+     */
+    if (c->running_queue->head != NULL) {
+        // task4: continue process
+        pcb_t *pcb = (pcb_t *)c->running_queue->head->data;
+        big_endian(c->simulation_time, c->big_endian);
+        continue_process(pcb->process, c->big_endian);
+    }
+}
+
+static int top_level(cycle_t *c) {
+    /*  Return the highest non-empty level, or FAILED if there are no ready
+        processes.
+     */
+    for (int i = 0; i < c->n_levels; i++) {
+        if (c->levels[i]->head) {
+            return i;
+        }
+    }
+    return FAILED;
+}
+
+static void boost(cycle_t *c) {
+    /*  Move every process back to the top level, keeping the order of
+        the levels.
+     */
+    for (int i = 1; i < c->n_levels; i++) {
+        pcb_t *pcb;
+        while ((pcb = (pcb_t *)pop(c->levels[i]))) {
+            pcb->level = 0;
+            pcb->slice_used = 0;
+            append(c->levels[0], pcb);
+        }
+    }
+    for (node_t *curr = c->running_queue->head; curr; curr = curr->next) {
+        pcb_t *pcb = (pcb_t *)curr->data;
+        pcb->level = 0;
+        pcb->slice_used = 0;
+    }
+}
+
+static void print_fairness_report(cycle_t *c) {
+    /*  Print the CPU time each tenant received against its fair share, the
+        sum over every cycle of its weight over the weight of all runnable
+        processes. Then print Jain's fairness index of the ratios, which is
+        1 when every tenant received the same fraction of its fair share.
+     */
+    double sum = 0, sum_squares = 0;
+    int n = 0;
+    settle_tenants(c);
+    for (node_t *curr = c->tenants->head; curr; curr = curr->next) {
+        tenant_t *tenant = (tenant_t *)curr->data;
+        double ratio = tenant->entitled ? tenant->received / tenant->entitled
+                                        : 0;
+        printf("TENANT,tenant=%s,processes=%d,cpu_time=%" PRIu32
+               ",fair_share=%.2f,ratio=%.2f\n",
+               tenant->name, tenant->processes, tenant->received,
+               tenant->entitled, ratio);
+        if (tenant->entitled) {
+            sum += ratio;
+            sum_squares += ratio * ratio;
+            n++;
+        }
+    }
+    printf("Fairness index %.4f\n", n ? sum * sum / (n * sum_squares) : 1.0);
+}
+
+static void charge_running(cycle_t *c) {
+    /*  Charge the running process for the cycle about to run, and give
+        every tenant its weighted share of the cycle.
+     */
+    pcb_t *pcb = (pcb_t *)c->running_queue->head->data;
+    uint32_t run =
+        pcb->remaining_time < c->quantum ? pcb->remaining_time : c->quantum;
+    pcb->vruntime += (uint64_t)run * CFS_WEIGHT_SCALE / pcb->weight;
+    pcb->slice_used++;
+
+    c->tenant_share += (double)run / c->tenant_weight;
+    find_tenant(c, pcb->tenant)->received += run;
+
+    // the smallest virtual runtime never decreases
+    uint64_t min_vruntime = pcb->vruntime;
+    pcb_t *leftmost = (pcb_t *)rbtree_min(c->vruntime_tree);
+    if (leftmost && leftmost->vruntime < min_vruntime) {
+        min_vruntime = leftmost->vruntime;
+    }
+    if (min_vruntime > c->min_vruntime) {
+        c->min_vruntime = min_vruntime;
+    }
+}
+
+static int has_process_quanta(cycle_t *c) {
+    /*  Return whether any finished process had its own quantum.
+     */
+    for (node_t *curr = c->finished_queue->head; curr; curr = curr->next) {
+        if (((pcb_t *)curr->data)->quantum) {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+static uint32_t adaptive_quantum(cycle_t *c) {
+    /*  Choose the length of the next cycle from the ready and running
+        processes. Long cycles mean fewer context switches, while short
+        cycles let short processes finish sooner and every process run
+        sooner when many are ready.
+     */
+    int n = list_len(c->ready_queue) + list_len(c->running_queue);
+    if (n == 0) {
+        return ADAPTIVE_MIN_QUANTUM;
+    }
+    if (n > c->adaptive_size) {
+        while (c->adaptive_size < n) {
+            c->adaptive_size = c->adaptive_size ? c->adaptive_size * 2 : 4;
+        }
+        c->adaptive_remaining = (uint32_t *)realloc(
+            c->adaptive_remaining, c->adaptive_size * sizeof(uint32_t));
+        assert(c->adaptive_remaining);
+    }
+    uint32_t *remaining = c->adaptive_remaining;
+    int i = 0;
+    for (node_t *curr = c->ready_queue->head; curr; curr = curr->next) {
+        remaining[i++] = ((pcb_t *)curr->data)->remaining_time;
+    }
+    for (node_t *curr = c->running_queue->head; curr; curr = curr->next) {
+        remaining[i++] = ((pcb_t *)curr->data)->remaining_time;
+    }
+
+    // long enough for most processes to finish, short enough for every
+    // ready process to run within the target latency
+    uint32_t quantum =
+        select_uint32(remaining, n, (ADAPTIVE_PERCENTILE * n + 99) / 100 - 1);
+    if (quantum > (uint32_t)(ADAPTIVE_TARGET_LATENCY / n)) {
+        quantum = (uint32_t)(ADAPTIVE_TARGET_LATENCY / n);
+    }
+    if (quantum < ADAPTIVE_MIN_QUANTUM) {
+        quantum = ADAPTIVE_MIN_QUANTUM;
+    }
+    if (quantum > ADAPTIVE_MAX_QUANTUM) {
+        quantum = ADAPTIVE_MAX_QUANTUM;
+    }
+    return quantum;
+}
+
+void end_cycle(cycle_t *c) {
+    /*  Once the scheduler has chosen the running process, set the length of
+        the cycle: the quantum of the running process if it has one, else
+        the adaptive or fixed quantum. Then charge the running process for
+        the cycle under CFS.
+     */
+    pcb_t *running =
+        c->running_queue->head ? (pcb_t *)c->running_queue->head->data : NULL;
+    if (running && running->quantum) {
+        c->quantum = running->quantum;
+    } else if (c->base_quantum) {
+        c->quantum = c->base_quantum;
+    } else {
+        c->quantum = adaptive_quantum(c);
+    }
+    if (running && c->vruntime_tree) {
+        charge_running(c);
+    }
+}
+
+static void print_deadline_statistics(cycle_t *c) {
+    /*  If any process has a deadline, print the number of processes that
+        finished after their deadline out of those with deadlines, and the
+        50th, 90th and 99th percentiles and maximum of their lateness, the
+        time they finished after their deadline (negative if before). Under
+        EDF, also print the number of rejected processes.
+     */
+    int n = 0, misses = 0;
+    int64_t *lateness =
+        (int64_t *)malloc((list_len(c->finished_queue) + 1) * sizeof(int64_t));
+    assert(lateness);
+    for (node_t *curr = c->finished_queue->head; curr; curr = curr->next) {
+        pcb_t *pcb = (pcb_t *)curr->data;
+        if (pcb->deadline == NO_DEADLINE) {
+            continue;
+        }
+        lateness[n++] = (int64_t)pcb->termination_time - pcb->deadline;
+        if (pcb->termination_time > pcb->deadline) {
+            misses++;
+        }
+    }
+    if (n > 0) {
+        qsort(lateness, n, sizeof(int64_t), cmp_lateness);
+        int percentiles[] = {50, 90, 99};
+        printf("Deadline misses %d %d\nLateness", misses, n);
+        for (int i = 0; i < 3; i++) {
+            // nearest rank
+            int rank = (percentiles[i] * n + 99) / 100;
+            printf(" %" PRId64, lateness[rank - 1]);
+        }
+        printf(" %" PRId64 "\n", lateness[n - 1]);
+    }
+    if (strcmp(c->args->scheduler, EDF) == 0) {
+        printf("Rejected %d\n", list_len(c->rejected_queue));
+    }
+    free(lateness);
+}
+
+void print_scheduler_statistics(cycle_t *c) {
+    /*  Print the statistics of the schedulers in this file after the
+        performance statistics.
+     */
+    int preemptive = strcmp(c->args->scheduler, MLFQ) == 0 ||
+                     strcmp(c->args->scheduler, SRTF) == 0 ||
+                     strcmp(c->args->scheduler, CFS) == 0 ||
+                     strcmp(c->args->scheduler, EDF) == 0;
+    int extended = preemptive || strcmp(c->args->scheduler, SJF_EST) == 0;
+    if (preemptive) {
+        printf("Preemptions %" PRIu32 "\n", c->preemptions);
+    }
+    if (extended || !c->base_quantum || has_process_quanta(c) ||
+        c->args->usage) {
+        printf("Context switches %" PRIu32 "\n", c->context_switches);
+    }
+    if (!c->base_quantum) {
+        printf("Average quantum %.2f\n",
+               c->cycles ? (double)c->simulation_time / c->cycles : 0);
+    }
+    if (c->vruntime_tree) {
+        print_fairness_report(c);
+    }
+    print_deadline_statistics(c);
+    if (strcmp(c->args->scheduler, SJF_EST) == 0) {
+        print_prediction_statistics(c);
+    }
+}
+
+void mlfq(cycle_t *c) {
+    /*  Multilevel Feedback Queue (MLFQ) scheduling algorithm.
+
+        The running process is preempted if it has used up the quanta of
+        its level and another process is ready at its new level or above,
+        or if a process is ready at a higher level. Otherwise it continues
+        to run. Preempted processes go to the back of their level.
+     */
+    if (c->boost_period && c->simulation_time >= c->next_boost) {
+        boost(c);
+        while (c->next_boost <= c->simulation_time) {
+            c->next_boost += c->boost_period;
+        }
+    }
+
+    if (c->running_queue->head != NULL) {
+        pcb_t *pcb = (pcb_t *)c->running_queue->head->data;
+        if (pcb->slice_used >= c->level_quanta[pcb->level]) {
+            // used up its quanta, move down a level
+            if (pcb->level < c->n_levels - 1) {
+                pcb->level++;
+            }
+            pcb->slice_used = 0;
+        }
+        int top = top_level(c);
+        int preempt = top != FAILED &&
+                      (top < pcb->level ||
+                       (top == pcb->level && pcb->slice_used == 0));
+        if (!preempt) {
+            pcb->slice_used++;
+            resume_running(c);
+            return;
+        }
+        preempt_process(c, pcb);
+    }
+
+    // run the process at the front of the highest non-empty level
+    int top = top_level(c);
+    if (top == FAILED) {
+        return;
+    }
+    pcb_t *pcb = (pcb_t *)pop(c->levels[top]);
+    pcb->slice_used++;
+    dispatch_process(c, pcb);
+}
+
+void srtf(cycle_t *c) {
+    /*  Shortest Remaining Time First (SRTF) scheduling algorithm.
+
+        The running process continues to run unless a ready process has a
+        strictly shorter remaining time, in which case it is suspended and
+        the shortest ready process runs instead. Ties are broken by arrival
+        time and then by name.
+     */
+    pcb_t *shortest = (pcb_t *)heap_peek(c->ready_heap);
+    if (c->running_queue->head != NULL) {
+        pcb_t *pcb = (pcb_t *)c->running_queue->head->data;
+        if (!shortest || shortest->remaining_time >= pcb->remaining_time) {
+            resume_running(c);
+            return;
+        }
+        preempt_process(c, pcb);
+    }
+
+    // run the ready process with the shortest remaining time
+    if (!shortest) {
+        return;
+    }
+    dispatch_process(c, (pcb_t *)heap_pop(c->ready_heap));
+}
+
+void cfs(cycle_t *c) {
+    /*  Completely Fair Scheduler (CFS) scheduling algorithm.
+
+        The running process is preempted once it has run for at least
+        CFS_MIN_GRANULARITY cycles and a ready process has a smaller virtual
+        runtime. Then the process with the smallest virtual runtime runs,
+        with ties broken by the order in which processes became ready.
+     */
+    pcb_t *leftmost = (pcb_t *)rbtree_min(c->vruntime_tree);
+    if (c->running_queue->head != NULL) {
+        pcb_t *pcb = (pcb_t *)c->running_queue->head->data;
+        if (!leftmost || pcb->slice_used < CFS_MIN_GRANULARITY ||
+            leftmost->vruntime >= pcb->vruntime) {
+            resume_running(c);
+            return;
+        }
+        preempt_process(c, pcb);
+    }
+
+    // run the ready process with the smallest virtual runtime
+    if (!leftmost) {
+        return;
+    }
+    pcb_t *pcb = (pcb_t *)rbtree_pop_min(c->vruntime_tree);
+    pcb->slice_used = 0;
+    dispatch_process(c, pcb);
+}
+
+void edf(cycle_t *c) {
+    /*  Earliest Deadline First (EDF) scheduling algorithm.
+
+        The running process continues to run unless a ready process has a
+        strictly earlier deadline, in which case it is suspended and the
+        ready process with the earliest deadline runs instead. Ties are
+        broken by arrival time and then by name.
+     */
+    pcb_t *earliest = (pcb_t *)heap_peek(c->ready_heap);
+    if (c->running_queue->head != NULL) {
+        pcb_t *pcb = (pcb_t *)c->running_queue->head->data;
+        if (!earliest || earliest->deadline >= pcb->deadline) {
+            resume_running(c);
+            return;
+        }
+        preempt_process(c, pcb);
+    }
+
+    // run the ready process with the earliest deadline
+    if (!earliest) {
+        return;
+    }
+    dispatch_process(c, (pcb_t *)heap_pop(c->ready_heap));
+}
+
+void sjf_est(cycle_t *c) {
+    /*  Shortest Job First with estimates (SJF-EST) scheduling algorithm.
+
+        As SJF, but find the process with the shortest predicted service
+        time, since the service time is not known until a process finishes.
+        Ties are broken by arrival time and then by name.
+     */
+    if (c->running_queue->head != NULL) {
+        // if there is a process currently running, continue to run
+        resume_running(c);
+        return;
+    }
+
+    // only add process to running queue if there is no running process
+    pcb_t *min = NULL;
+    for (node_t *curr = c->ready_queue->head; curr; curr = curr->next) {
+        pcb_t *pcb = (pcb_t *)curr->data;
+        pcb->predicted = predict_service_time(c, pcb);
+        if (!min || pcb->predicted < min->predicted ||
+            (pcb->predicted == min->predicted &&
+             (pcb->arrival_time < min->arrival_time ||
+              (pcb->arrival_time == min->arrival_time &&
+               strcmp(pcb->name, min->name) < 0)))) {
+            min = pcb;
+        }
+    }
+    if (min) {
+        dispatch_process(c, min);
+    }
+}
+
+void sjf_aging(cycle_t *c) {
+    /*  Shortest Job First (SJF) scheduling algorithm with aging.
+
+        As SJF, but the remaining time of a waiting process is reduced by
+        the aging rate for every second it has waited. The running process
+        is never preempted.
+     */
+    if (c->running_queue->head != NULL) {
+        // if there is a process currently running, continue to run
+        resume_running(c);
+        return;
+    }
+
+    // run the ready process with the highest aged priority
+    if (heap_len(c->ready_heap) == 0) {
+        return;
+    }
+    dispatch_process(c, (pcb_t *)heap_pop(c->ready_heap));
+}
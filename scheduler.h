@@ -0,0 +1,47 @@
+/* =============================================================================
+   scheduler.h
+
+   Schedulers other than SJF and RR, and the helpers they share to dispatch
+   and preempt processes. Each scheduler keeps its own structure of ready
+   processes for selection, in addition to the ready queue of the cycle.
+
+   Author: David Sha
+============================================================================= */
+#ifndef _SCHEDULER_H_
+#define _SCHEDULER_H_
+
+/* #includes ================================================================ */
+#include "main.h"
+
+/* structures =============================================================== */
+typedef struct tenant {
+    char *name;
+    int processes;
+    uint64_t runnable_weight;
+    uint32_t received;
+    double entitled;
+    double share_mark;
+} tenant_t;
+
+/* function prototypes ====================================================== */
+void init_scheduler(cycle_t *c);
+void free_scheduler(cycle_t *c);
+void enqueue_ready(cycle_t *c, pcb_t *pcb);
+void finish_scheduled(cycle_t *c, pcb_t *pcb);
+int admit_process(cycle_t *c, pcb_t *pcb);
+tenant_t *find_tenant(cycle_t *c, char *name);
+void settle_tenants(cycle_t *c);
+void restore_scheduler(cycle_t *c);
+void dispatch_process(cycle_t *c, pcb_t *pcb);
+void preempt_process(cycle_t *c, pcb_t *pcb);
+void resume_running(cycle_t *c);
+void end_cycle(cycle_t *c);
+void print_scheduler_statistics(cycle_t *c);
+void mlfq(cycle_t *c);
+void srtf(cycle_t *c);
+void cfs(cycle_t *c);
+void edf(cycle_t *c);
+void sjf_est(cycle_t *c);
+void sjf_aging(cycle_t *c);
+
+#endif
@@ -0,0 +1,83 @@
+/* =============================================================================
+   series.c
+
+   The implementation of time series. Each column is a growable array that
+   is doubled when full, like the heap.
+
+   Author: David Sha
+============================================================================= */
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include "series.h"
+
+#define INITIAL_SIZE 64
+
+series_t *create_series(const char *const *names) {
+    /*  Create an empty series with a column for each of the NULL terminated
+        `names`.
+     */
+    series_t *series;
+    series = (series_t *)malloc(sizeof(*series));
+    assert(series);
+    series->names = names;
+    series->n_columns = 0;
+    while (names[series->n_columns]) {
+        series->n_columns++;
+    }
+    series->len = 0;
+    series->size = INITIAL_SIZE;
+    series->columns = (double **)malloc(series->n_columns * sizeof(double *));
+    assert(series->columns);
+    for (int i = 0; i < series->n_columns; i++) {
+        series->columns[i] = (double *)malloc(series->size * sizeof(double));
+        assert(series->columns[i]);
+    }
+    return series;
+}
+
+void free_series(series_t *series) {
+    /*  Free a series.
+     */
+    for (int i = 0; i < series->n_columns; i++) {
+        free(series->columns[i]);
+    }
+    free(series->columns);
+    free(series);
+}
+
+void series_add(series_t *series, const double *values) {
+    /*  Add a sample, with a value for every column.
+     */
+    if (series->len == series->size) {
+        series->size *= 2;
+        for (int i = 0; i < series->n_columns; i++) {
+            series->columns[i] = (double *)realloc(
+                series->columns[i], series->size * sizeof(double));
+            assert(series->columns[i]);
+        }
+    }
+    for (int i = 0; i < series->n_columns; i++) {
+        series->columns[i][series->len] = values[i];
+    }
+    series->len++;
+}
+
+void write_series(series_t *series, FILE *fp) {
+    /*  Write each column on its own line, as its name followed by its
+        values separated by spaces. Values are written in the shortest form
+        that round trips for integers and to 4 decimal places otherwise.
+     */
+    for (int i = 0; i < series->n_columns; i++) {
+        fputs(series->names[i], fp);
+        for (int j = 0; j < series->len; j++) {
+            double value = series->columns[i][j];
+            if (value == (long long)value) {
+                fprintf(fp, " %lld", (long long)value);
+            } else {
+                fprintf(fp, " %.4f", value);
+            }
+        }
+        fputc('\n', fp);
+    }
+}
@@ -0,0 +1,30 @@
+/* =============================================================================
+   series.h
+
+   Time series of samples stored by column, so that each column can be
+   written out as one line.
+
+   Author: David Sha
+============================================================================= */
+#ifndef _SERIES_H_
+#define _SERIES_H_
+
+/* #includes ================================================================ */
+#include <stdio.h>
+
+/* structures =============================================================== */
+typedef struct series {
+    const char *const *names;
+    int n_columns;
+    int len;
+    int size;
+    double **columns;
+} series_t;
+
+/* function prototypes ====================================================== */
+series_t *create_series(const char *const *names);
+void free_series(series_t *series);
+void series_add(series_t *series, const double *values);
+void write_series(series_t *series, FILE *fp);
+
+#endif
@@ -0,0 +1,112 @@
+/*
+	sha256-bench.c, checks and times the SHA-256 block functions in sha256.c
+	Usage: ./sha256-bench [iterations]
+
+	Every supported implementation is first checked against the FIPS 180-2
+	test vectors and against the scalar implementation on buffers of every
+	length up to 512 bytes. Then each is timed hashing the 119 byte buffer
+	that the process executable hashes on termination.
+	Exits with failure if any digest differs.
+*/
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "sha256.h"
+
+#define MAX_LENGTH 512
+#define PROCESS_LENGTH (128 - 9)
+
+static const char* implementations[] = {"scalar", "shani", NULL};
+
+/* FIPS 180-2 Appendix B and the empty message */
+static const struct {
+	const char* message;
+	const char* digest;
+} vectors[] = {
+	{"", "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855"},
+	{"abc",
+	 "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"},
+	{"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+	 "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1"},
+	{"abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmnhijklmnoijklm"
+	 "nopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu",
+	 "cf5b16a778af8380036ce59e7b0492370b249b11e8f07a51afac45037afee9d1"},
+	{NULL, NULL}};
+
+int check(const char* name, const uint8_t* random) {
+	int i, length, failed = 0;
+	char hash[65], expected[65];
+
+	for (i = 0; vectors[i].message; i++) {
+		sha256_hash(hash, (const uint8_t*)vectors[i].message,
+					strlen(vectors[i].message));
+		if (strcmp(hash, vectors[i].digest) != 0) {
+			fprintf(stderr, "%s: vector %d gave %s\n", name, i, hash);
+			failed = 1;
+		}
+	}
+
+	/* compare with scalar on every length, covering all padding cases */
+	for (length = 0; length <= MAX_LENGTH; length++) {
+		sha256_select("scalar");
+		sha256_hash(expected, random, length);
+		sha256_select(name);
+		sha256_hash(hash, random, length);
+		if (strcmp(hash, expected) != 0) {
+			fprintf(stderr, "%s: length %d gave %s, expected %s\n", name,
+					length, hash, expected);
+			failed = 1;
+		}
+	}
+	return failed;
+}
+
+double bench(const uint8_t* random, long iterations) {
+	long i;
+	char hash[65];
+	struct timespec start, end;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < iterations; i++) {
+		sha256_hash(hash, random + (i & 7), PROCESS_LENGTH);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	return ((end.tv_sec - start.tv_sec) * 1e9 +
+			(end.tv_nsec - start.tv_nsec)) /
+		   iterations;
+}
+
+int main(int argc, char* argv[]) {
+	int i, failed = 0;
+	long iterations = argc > 1 ? atol(argv[1]) : 1000000;
+	uint8_t random[MAX_LENGTH + 8];
+
+	srand(30023);
+	for (i = 0; i < MAX_LENGTH + 8; i++) {
+		random[i] = rand() & 0xFF;
+	}
+
+	printf("default: %s\n", sha256_implementation());
+	for (i = 0; implementations[i]; i++) {
+		const char* name = implementations[i];
+		if (sha256_select(name) != 0) {
+			printf("%-6s  not supported\n", name);
+			continue;
+		}
+		if (check(name, random) != 0) {
+			printf("%-6s  FAILED\n", name);
+			failed = 1;
+			continue;
+		}
+		sha256_select(name);
+		printf("%-6s  ok  %8.1f ns per %d byte hash\n", name,
+			   bench(random, iterations), PROCESS_LENGTH);
+	}
+
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,26 @@
+/*
+	sha256.h, SHA-256 used by the dummy process in COMP30023 2023 Project 1
+	Reference: RFC 6234
+*/
+
+#ifndef _SHA256_H_
+#define _SHA256_H_
+
+#include <stdint.h>
+
+typedef void (*sha256_block_fn)(uint32_t message_block[16], uint32_t hash[8]);
+
+void sha256_hash(char hash_hexstring[65], const uint8_t* buf,
+				 const uint64_t nbyte);
+void sha256_init(uint32_t hash[8]);
+void sha256_process(uint32_t message_block[16], uint32_t hash[8]);
+#if defined(__x86_64__) || defined(__i386__)
+void sha256_process_shani(uint32_t message_block[16], uint32_t hash[8]);
+#endif
+void sha256_process_final(uint64_t nbyte, short leftover_bytes,
+						  uint32_t last_block[16], uint32_t hash[8]);
+void uint32_array_to_hex_string(char* out, uint32_t* in, unsigned long length);
+int sha256_select(const char* name);
+const char* sha256_implementation(void);
+
+#endif
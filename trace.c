@@ -0,0 +1,290 @@
+/* =============================================================================
+   trace.c
+
+   The implementation of the trace export. Events are streamed to the file
+   through a large stdio buffer as the simulation runs, so memory use does
+   not grow with the length of the run. Simulated seconds are written as
+   seconds of trace time.
+
+   The trace has three processes:
+   - the simulated CPU, with a slice for every interval a process runs and
+     counters of the input and ready queue lengths and memory in use;
+   - memory, with a track per block address and a slice for every block
+     from its allocation to its release;
+   - the process API, with a slice for every call lasting its real wall
+     time, placed at the simulated time of the cycle that made it.
+
+   Author: David Sha
+============================================================================= */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <inttypes.h>
+#include <arpa/inet.h>
+#include "trace.h"
+
+#define CPU_PID 1
+#define MEMORY_PID 2
+#define API_PID 3
+#define US_PER_SECOND 1000000
+
+typedef struct allocation {
+    char *name;
+    uint16_t location;
+    uint16_t size;
+    uint32_t start;
+} allocation_t;
+
+static FILE *trace = NULL;
+static char *buffer = NULL;
+static int first_event = TRUE;
+
+// the slice of the running process, which is only written once it ends
+static char *running = NULL;
+static uint32_t running_since = 0;
+
+// last values of the counters, which are only written when they change
+static int last_input = FAILED;
+static int last_ready = FAILED;
+static int64_t last_memory = FAILED;
+
+static list_t *allocations = NULL;
+
+// API calls of a cycle are placed one after another from its start
+static uint32_t api_time = 0;
+static uint64_t api_cursor = 0;
+
+static const char *const OP_NAMES[] = {"start", "suspend", "continue",
+                                       "terminate"};
+
+static void begin_event() {
+    /*  Separate an event from the previous one.
+     */
+    fputs(first_event ? "\n" : ",\n", trace);
+    first_event = FALSE;
+}
+
+static void write_name(const char *name) {
+    /*  Write a string as a JSON string.
+     */
+    fputc('"', trace);
+    for (; *name; name++) {
+        if (*name == '"' || *name == '\\') {
+            fputc('\\', trace);
+        }
+        fputc(*name, trace);
+    }
+    fputc('"', trace);
+}
+
+static void write_metadata(int pid, int tid, char *kind, char *name) {
+    /*  Name a process or thread of the trace.
+     */
+    begin_event();
+    fprintf(trace,
+            "{\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"name\":\"%s\","
+            "\"args\":{\"name\":",
+            pid, tid, kind);
+    write_name(name);
+    fputs("}}", trace);
+}
+
+static void write_slice(int pid, int tid, const char *name, uint64_t ts,
+                        uint64_t dur) {
+    /*  Write a complete event, with its time and duration in microseconds.
+        The arguments of the event are written by the caller, which closes
+        the event.
+     */
+    begin_event();
+    fprintf(trace, "{\"ph\":\"X\",\"pid\":%d,\"tid\":%d,\"name\":", pid, tid);
+    write_name(name);
+    fprintf(trace, ",\"ts\":%" PRIu64 ",\"dur\":%" PRIu64, ts, dur);
+}
+
+static void write_counter(char *name, char *key, int64_t value,
+                          uint32_t time) {
+    /*  Write the value of a counter of the simulated CPU.
+     */
+    begin_event();
+    fprintf(trace,
+            "{\"ph\":\"C\",\"pid\":%d,\"name\":\"%s\",\"ts\":%" PRIu64
+            ",\"args\":{\"%s\":%" PRId64 "}}",
+            CPU_PID, name, (uint64_t)time * US_PER_SECOND, key, value);
+}
+
+void open_trace(char *file) {
+    /*  Start writing a trace to a file.
+     */
+    trace = fopen(file, "w");
+    if (!trace) {
+        perror(file);
+        exit(EXIT_FAILURE);
+    }
+    buffer = (char *)malloc(TRACE_BUFFER_SIZE);
+    assert(buffer);
+    setvbuf(trace, buffer, _IOFBF, TRACE_BUFFER_SIZE);
+    allocations = create_empty_list();
+    fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", trace);
+    write_metadata(CPU_PID, 0, "process_name", "Simulated CPU");
+    write_metadata(CPU_PID, 0, "thread_name", "CPU 0");
+    write_metadata(MEMORY_PID, 0, "process_name", "Memory");
+    write_metadata(API_PID, 0, "process_name", "Process API");
+    write_metadata(API_PID, 0, "thread_name", "Real latency");
+}
+
+int is_tracing() {
+    /*  Return TRUE if a trace is being written.
+     */
+    return trace != NULL;
+}
+
+static void end_running(uint32_t time) {
+    /*  Write the slice of the running process, which stopped running at
+        `time`.
+     */
+    if (!running) {
+        return;
+    }
+    write_slice(CPU_PID, 0, running, (uint64_t)running_since * US_PER_SECOND,
+                (uint64_t)(time - running_since) * US_PER_SECOND);
+    fputs("}", trace);
+    running = NULL;
+}
+
+void trace_cycle(cycle_t *c) {
+    /*  Record the process that runs in this cycle and the counters, after
+        the cycle has been run.
+     */
+    if (!trace) {
+        return;
+    }
+    uint32_t time = c->simulation_time;
+    pcb_t *pcb = c->running_queue->head
+                     ? (pcb_t *)c->running_queue->head->data
+                     : NULL;
+    if (!pcb || pcb->name != running) {
+        end_running(time);
+        if (pcb) {
+            running = pcb->name;
+            running_since = time;
+        }
+    }
+
+    int input = list_len(c->input_queue);
+    if (input != last_input) {
+        write_counter("Input queue", "processes", input, time);
+        last_input = input;
+    }
+    int ready = list_len(c->ready_queue);
+    if (ready != last_ready) {
+        write_counter("Ready queue", "processes", ready, time);
+        last_ready = ready;
+    }
+
+    // memory in allocated blocks, or in frames in use if paged
+    int64_t memory = 0;
+    if (c->paged_memory) {
+        memory = (int64_t)(c->paged_memory->n_frames -
+                           c->paged_memory->lists[FREE_FRAMES].len) *
+                 PAGE_SIZE;
+    } else {
+        memory = c->memory->size - c->memory->free_bytes;
+    }
+    if (memory != last_memory) {
+        write_counter("Memory", "used", memory, time);
+        last_memory = memory;
+    }
+}
+
+void trace_alloc(char *name, block_t *block, uint32_t time) {
+    /*  Record that a block was allocated to a process. Its slice is written
+        when it is freed.
+     */
+    if (!trace) {
+        return;
+    }
+    allocation_t *allocation;
+    allocation = (allocation_t *)malloc(sizeof(*allocation));
+    assert(allocation);
+    allocation->name = name;
+    allocation->location = block->location;
+    allocation->size = block->size;
+    allocation->start = time;
+    append(allocations, allocation);
+    block->trace_node = allocations->foot;
+}
+
+static void write_allocation(allocation_t *allocation, uint32_t time) {
+    /*  Write the slice of a block on the track of its address.
+     */
+    write_slice(MEMORY_PID, allocation->location, allocation->name,
+                (uint64_t)allocation->start * US_PER_SECOND,
+                (uint64_t)(time - allocation->start) * US_PER_SECOND);
+    fprintf(trace, ",\"args\":{\"location\":%" PRIu16 ",\"size\":%" PRIu16 "}}",
+            allocation->location, allocation->size);
+}
+
+void trace_free(block_t *block, uint32_t time) {
+    /*  Record that a block is about to be freed, finding its allocation
+        through the node kept in the block.
+     */
+    if (!trace || !block->trace_node) {
+        return;
+    }
+    allocation_t *allocation = (allocation_t *)block->trace_node->data;
+    write_allocation(allocation, time);
+    remove_node(allocations, block->trace_node);
+    block->trace_node = NULL;
+    free(allocation);
+}
+
+void trace_api(char *name, op_t op, char *simulation_time, uint64_t start,
+               uint64_t end) {
+    /*  Record a call to the process API that took from `start` to `end`
+        nanoseconds of wall time, made in the cycle at the big endian
+        `simulation_time`.
+     */
+    if (!trace) {
+        return;
+    }
+    uint32_t time;
+    memcpy(&time, simulation_time, sizeof(time));
+    time = ntohl(time);
+    uint64_t ts = (uint64_t)time * US_PER_SECOND;
+    if (time != api_time || api_cursor < ts) {
+        api_time = time;
+        api_cursor = ts;
+    }
+    uint64_t dur = (end - start + 999) / 1000;
+    write_slice(API_PID, 0, OP_NAMES[op], api_cursor, dur ? dur : 1);
+    fputs(",\"args\":{\"process\":", trace);
+    write_name(name);
+    fprintf(trace, ",\"ns\":%" PRIu64 "}}", end - start);
+    api_cursor += dur ? dur : 1;
+}
+
+void close_trace(cycle_t *c) {
+    /*  Write the slices that are still open at the end of the simulation
+        and close the trace.
+     */
+    if (!trace) {
+        return;
+    }
+    end_running(c->simulation_time);
+    while (!is_empty_list(allocations)) {
+        allocation_t *allocation = (allocation_t *)pop(allocations);
+        write_allocation(allocation, c->simulation_time);
+        free(allocation);
+    }
+    free_list(allocations, NULL);
+    allocations = NULL;
+    fputs("\n]}\n", trace);
+    if (fclose(trace) == EOF) {
+        perror("fclose");
+        exit(EXIT_FAILURE);
+    }
+    trace = NULL;
+    free(buffer);
+    buffer = NULL;
+}
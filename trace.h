@@ -0,0 +1,26 @@
+/* =============================================================================
+   trace.h
+
+   Export of the simulated timeline in the Trace Event Format, which can be
+   opened in chrome://tracing or Perfetto.
+
+   Author: David Sha
+============================================================================= */
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+/* #includes ================================================================ */
+#include <stdint.h>
+#include "main.h"
+
+/* function prototypes ====================================================== */
+void open_trace(char *file);
+int is_tracing();
+void trace_cycle(cycle_t *c);
+void trace_alloc(char *name, block_t *block, uint32_t time);
+void trace_free(block_t *block, uint32_t time);
+void trace_api(char *name, op_t op, char *simulation_time, uint64_t start,
+               uint64_t end);
+void close_trace(cycle_t *c);
+
+#endif
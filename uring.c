@@ -0,0 +1,139 @@
+/* =============================================================================
+   uring.c
+
+   A minimal io_uring wrapper built directly on the io_uring system calls.
+   Requests are queued in the submission ring and submitted together with
+   one `io_uring_enter()` call, which also waits for their completions.
+
+   Reference:
+   - https://man7.org/linux/man-pages/man7/io_uring.7.html
+
+   Author: David Sha
+============================================================================= */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include "config.h"
+#include "uring.h"
+
+uring_t *create_uring(unsigned entries) {
+    /*  Create an io_uring instance with room for `entries` requests.
+        Return NULL if io_uring is not available.
+     */
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+    if (fd == FAILED) {
+        return NULL;
+    }
+
+    uring_t *ring;
+    ring = (uring_t *)malloc(sizeof(*ring));
+    assert(ring);
+    ring->fd = fd;
+    ring->entries = params.sq_entries;
+    ring->queued = 0;
+
+    // map the submission ring, completion ring and submission entries
+    ring->sq_ring_size =
+        params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_ring_size =
+        params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    ring->cq_ring = mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (ring->sq_ring == MAP_FAILED || ring->cq_ring == MAP_FAILED ||
+        ring->sqes == MAP_FAILED) {
+        perror("mmap");
+        exit(EXIT_FAILURE);
+    }
+
+    char *sq = (char *)ring->sq_ring;
+    char *cq = (char *)ring->cq_ring;
+    ring->sq_tail = (unsigned *)(sq + params.sq_off.tail);
+    ring->sq_mask = (unsigned *)(sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned *)(sq + params.sq_off.array);
+    ring->cq_head = (unsigned *)(cq + params.cq_off.head);
+    ring->cq_tail = (unsigned *)(cq + params.cq_off.tail);
+    ring->cq_mask = (unsigned *)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+
+    return ring;
+}
+
+void free_uring(uring_t *ring) {
+    /*  Unmap the rings and close the io_uring instance.
+     */
+    munmap(ring->sqes, ring->sqes_size);
+    munmap(ring->cq_ring, ring->cq_ring_size);
+    munmap(ring->sq_ring, ring->sq_ring_size);
+    close(ring->fd);
+    free(ring);
+}
+
+int queue_uring(uring_t *ring, uint8_t opcode, int fd, void *buf,
+                unsigned length, uint64_t user_data) {
+    /*  Queue a read or write request without submitting it. Return FALSE
+        if the submission ring is full.
+     */
+    if (ring->queued == ring->entries) {
+        return FALSE;
+    }
+    unsigned tail = *ring->sq_tail + ring->queued;
+    unsigned index = tail & *ring->sq_mask;
+    struct io_uring_sqe *sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = opcode;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)(uintptr_t)buf;
+    sqe->len = length;
+    sqe->off = (uint64_t)-1; // use the current file position, as for pipes
+    sqe->user_data = user_data;
+    ring->sq_array[index] = index;
+    ring->queued++;
+    return TRUE;
+}
+
+int submit_uring(uring_t *ring, unsigned wait) {
+    /*  Submit all queued requests and wait for at least `wait` completions
+        with a single system call. Return the number of requests submitted.
+     */
+    __atomic_store_n(ring->sq_tail, *ring->sq_tail + ring->queued,
+                     __ATOMIC_RELEASE);
+    unsigned queued = ring->queued;
+    ring->queued = 0;
+    int submitted;
+    do {
+        submitted = (int)syscall(__NR_io_uring_enter, ring->fd, queued, wait,
+                                 IORING_ENTER_GETEVENTS, NULL, 0);
+    } while (submitted == FAILED && errno == EINTR);
+    if (submitted == FAILED) {
+        perror("io_uring_enter");
+        exit(EXIT_FAILURE);
+    }
+    return submitted;
+}
+
+int reap_uring(uring_t *ring, uint64_t *user_data, int32_t *res) {
+    /*  Take one completion from the completion ring. Return FALSE if there
+        are no completions.
+     */
+    unsigned head = *ring->cq_head;
+    if (head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)) {
+        return FALSE;
+    }
+    struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cq_mask];
+    *user_data = cqe->user_data;
+    *res = cqe->res;
+    __atomic_store_n(ring->cq_head, head + 1, __ATOMIC_RELEASE);
+    return TRUE;
+}
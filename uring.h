@@ -0,0 +1,45 @@
+/* =============================================================================
+   uring.h
+
+   A minimal io_uring wrapper built directly on the io_uring system calls,
+   used to submit many pipe reads and writes with a single system call.
+
+   Author: David Sha
+============================================================================= */
+#ifndef _URING_H_
+#define _URING_H_
+
+/* #includes ================================================================ */
+#include <stddef.h>
+#include <stdint.h>
+#include <linux/io_uring.h>
+
+/* structures =============================================================== */
+typedef struct uring {
+    int fd;
+    unsigned entries;
+    unsigned queued;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void *sq_ring;
+    void *cq_ring;
+    size_t sq_ring_size;
+    size_t cq_ring_size;
+    size_t sqes_size;
+} uring_t;
+
+/* function prototypes ====================================================== */
+uring_t *create_uring(unsigned entries);
+void free_uring(uring_t *ring);
+int queue_uring(uring_t *ring, uint8_t opcode, int fd, void *buf,
+                unsigned length, uint64_t user_data);
+int submit_uring(uring_t *ring, unsigned wait);
+int reap_uring(uring_t *ring, uint64_t *user_data, int32_t *res);
+
+#endif